@@ -0,0 +1,272 @@
+#include "Triangulation.h"
+#include "FindCameraMatrices.h"
+#include "Ransac.h"
+#include "Utility.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include <iomanip>
+#include <functional>
+
+// microbenchmark of the triangulation and camera matrix kernels on synthetic correspondences.
+// reports the time per call and per point (best of several runs) and the heap allocations per call.
+// usage: Benchmark [max number of points]   (default 50000)
+
+// count every heap allocation (operator new and cv::fastMalloc both end up in malloc)
+static std::atomic<long> allocations(0);
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t number, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t number, size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(number, size);
+}
+
+void* realloc(void* pointer, size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+}
+#endif
+
+struct Scene {
+    cv::Mat K;
+    cv::Mat P_L, P_R;           // calibrated stereo rig K[I|0], K[I|-b]
+    cv::Mat E;                  // essential matrix between the left camera of two frames
+    vector<cv::Point3f> points3D;
+    vector<cv::Point2f> points_L1, points_R1, points_L2;
+};
+
+// random points 1 .. 10 m in front of a rig with 20 cm baseline, second frame moved
+// 10 cm forward and rotated by 2 degree. 0.3 pixel noise on all image points.
+static void createScene(int numberOfPoints, Scene& scene){
+    cv::RNG rng(42);
+
+    scene.K = (cv::Mat_<float>(3,3) <<
+               700,   0, 320,
+                 0, 700, 240,
+                 0,   0,   1);
+
+    cv::Mat R_0 = cv::Mat::eye(3, 3, CV_32F);
+    cv::Mat T_0 = cv::Mat::zeros(3, 1, CV_32F);
+    cv::Mat T_LR = (cv::Mat_<float>(3,1) << -200, 0, 0);
+
+    cv::Mat P, P_LR;
+    composeProjectionMat(T_0, R_0, P);
+    composeProjectionMat(T_LR, R_0, P_LR);
+    scene.P_L = scene.K * P;
+    scene.P_R = scene.K * P_LR;
+
+    cv::Mat rvec = (cv::Mat_<float>(3,1) << 0, 2 * CV_PI / 180, 0);
+    cv::Mat R_2;
+    cv::Rodrigues(rvec, R_2);
+    R_2.convertTo(R_2, CV_32F);
+    cv::Mat T_2 = (cv::Mat_<float>(3,1) << 0, 0, -100);
+
+    // E = [t]x R
+    cv::Mat t_x = (cv::Mat_<float>(3,3) <<
+                   0, -T_2.at<float>(2), T_2.at<float>(1),
+                   T_2.at<float>(2), 0, -T_2.at<float>(0),
+                   -T_2.at<float>(1), T_2.at<float>(0), 0);
+    scene.E = t_x * R_2;
+
+    cv::Mat P_2;
+    composeProjectionMat(T_2, R_2, P_2);
+    cv::Mat P_L2 = scene.K * P_2;
+
+    scene.points3D.clear();
+    scene.points_L1.clear();
+    scene.points_R1.clear();
+    scene.points_L2.clear();
+    for (int i = 0; i < numberOfPoints; ++i) {
+        float z = rng.uniform(1000.f, 10000.f);
+        float x = (rng.uniform(0.f, 640.f) - 320) * z / 700;
+        float y = (rng.uniform(0.f, 480.f) - 240) * z / 700;
+        cv::Mat X = (cv::Mat_<float>(4,1) << x, y, z, 1);
+
+        cv::Mat x_L1 = scene.P_L * X;
+        cv::Mat x_R1 = scene.P_R * X;
+        cv::Mat x_L2 = P_L2 * X;
+
+        scene.points3D.push_back(cv::Point3f(x, y, z));
+        scene.points_L1.push_back(cv::Point2f(x_L1.at<float>(0) / x_L1.at<float>(2) + rng.gaussian(0.3),
+                                              x_L1.at<float>(1) / x_L1.at<float>(2) + rng.gaussian(0.3)));
+        scene.points_R1.push_back(cv::Point2f(x_R1.at<float>(0) / x_R1.at<float>(2) + rng.gaussian(0.3),
+                                              x_R1.at<float>(1) / x_R1.at<float>(2) + rng.gaussian(0.3)));
+        scene.points_L2.push_back(cv::Point2f(x_L2.at<float>(0) / x_L2.at<float>(2) + rng.gaussian(0.3),
+                                              x_L2.at<float>(1) / x_L2.at<float>(2) + rng.gaussian(0.3)));
+    }
+}
+
+// runs kernel until at least 0.2 s are spent (at least 3, at most 1000 runs) and prints the best run
+static void benchmark(const string& name, int numberOfPoints, const std::function<void()>& kernel){
+    typedef std::chrono::steady_clock Clock;
+
+    // warm up, first call may allocate caches
+    kernel();
+
+    double best = 1e30;
+    double total = 0;
+    long allocationsPerCall = 0;
+    int runs = 0;
+    while ((3 > runs || 0.2 > total) && 1000 > runs) {
+        long allocationsBefore = allocations.load();
+        Clock::time_point start = Clock::now();
+        kernel();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        allocationsPerCall = allocations.load() - allocationsBefore;
+
+        best = std::min(best, seconds);
+        total += seconds;
+        ++runs;
+    }
+
+    std::cout << std::left << std::setw(34) << name
+              << std::right << std::setw(8) << numberOfPoints
+              << std::setw(16) << std::fixed << std::setprecision(0) << best * 1e9
+              << std::setw(14) << std::setprecision(1) << best * 1e9 / numberOfPoints
+              << std::setw(14) << allocationsPerCall
+              << std::endl;
+}
+
+int main(int argc, char** argv){
+    int maxPoints = (1 < argc) ? atoi(argv[1]) : 50000;
+
+    const int sizes[] = {100, 500, 1000, 5000, 10000, 50000};
+
+    std::cout << std::left << std::setw(34) << "kernel"
+              << std::right << std::setw(8) << "points"
+              << std::setw(16) << "ns/call"
+              << std::setw(14) << "ns/point"
+              << std::setw(14) << "allocs/call"
+              << std::endl;
+
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxPoints; ++s) {
+        int n = sizes[s];
+
+        Scene scene;
+        createScene(n, scene);
+
+        vector<cv::Point3f> points1_h, points2_h;
+        cv::convertPointsToHomogeneous(scene.points_L1, points1_h);
+        cv::convertPointsToHomogeneous(scene.points_R1, points2_h);
+        cv::Matx34f P_L(scene.P_L), P_R(scene.P_R);
+
+        vector<cv::Point3f> cloud;
+        cloud.reserve(n);
+
+        benchmark("LinearLSTriangulation", n, [&](){
+            for (int i = 0; i < n; ++i) {
+                cv::Mat_<float> X = LinearLSTriangulation(points1_h[i], P_L, points2_h[i], P_R);
+            }
+        });
+
+        benchmark("IterativeLinearLSTriangulation", n, [&](){
+            for (int i = 0; i < n; ++i) {
+                cv::Mat_<float> X = IterativeLinearLSTriangulation(points1_h[i], P_L, points2_h[i], P_R);
+            }
+        });
+
+        benchmark("TriangulatePointsHZ", n, [&](){
+            TriangulatePointsHZ(scene.P_L, scene.P_R, scene.points_L1, scene.points_R1, 0, cloud);
+        });
+
+        vector<float> x_L(n), y_L(n), x_R(n), y_R(n), X(n), Y(n), Z(n);
+        for (int i = 0; i < n; ++i) {
+            x_L[i] = scene.points_L1[i].x;
+            y_L[i] = scene.points_L1[i].y;
+            x_R[i] = scene.points_R1[i].x;
+            y_R[i] = scene.points_R1[i].y;
+        }
+        cv::Matx34d P_L64(P_L), P_R64(P_R);
+
+        benchmark("TriangulateLinearBatch", n, [&](){
+            TriangulateLinearBatch(P_L64, P_R64, &x_L[0], &y_L[0], &x_R[0], &y_R[0], n, &X[0], &Y[0], &Z[0]);
+        });
+
+        // the synthetic rig is rectified
+        cv::Mat Q;
+        composeRectifiedQ(scene.K, scene.K, (cv::Mat_<float>(3,1) << -200, 0, 0), Q);
+        benchmark("TriangulateStereo", n, [&](){
+            TriangulateStereo(Q, scene.points_L1, scene.points_R1, cloud);
+        });
+
+        benchmark("triangulate", n, [&](){
+            triangulate(scene.P_L, scene.P_R, scene.points_L1, scene.points_R1, cloud);
+        });
+
+        benchmark("TriangulateOpenCV", n, [&](){
+            TriangulateOpenCV(scene.P_L, scene.P_R, scene.points_L1, scene.points_R1, cloud);
+        });
+
+        benchmark("calculateReprojectionErrorHZ", n, [&](){
+            calculateReprojectionErrorHZ(scene.P_L, scene.points_L1, scene.points3D);
+        });
+
+        // independent of the number of points
+        benchmark("DecomposeEtoRandT", 1, [&](){
+            cv::Mat_<float> R1, R2, t1, t2;
+            DecomposeEtoRandT(scene.E, R1, R2, t1, t2);
+        });
+
+        benchmark("cv::findFundamentalMat", n, [&](){
+            vector<uchar> mask;
+            cv::findFundamentalMat(scene.points_L1, scene.points_L2, cv::FM_RANSAC, 5., .99, mask);
+        });
+
+        benchmark("findFundamentalMatRansac", n, [&](){
+            vector<uchar> mask;
+            cv::Matx33d F;
+            findFundamentalMatRansac(scene.points_L1, scene.points_L2, mask, F, 5., .99, 1000);
+        });
+
+        cv::Mat KInv = scene.K.inv();
+        benchmark("getEssentialMatrix", n, [&](){
+            vector<uchar> valid(scene.points_L1.size(), 1);
+            cv::Mat E;
+            getEssentialMatrix(scene.points_L1, scene.points_L2, KInv, valid, E);
+        });
+
+        benchmark("cv::solvePnPRansac", n, [&](){
+            cv::Mat rvec, tvec;
+            vector<int> inliers;
+            cv::solvePnPRansac(scene.points3D, scene.points_L2, scene.K, cv::Mat(), rvec, tvec, false, 1000, 3., 0.25 * n, inliers, CV_EPNP);
+        });
+
+        cv::Matx33d K64(scene.K);
+        benchmark("findPoseRansac", n, [&](){
+            vector<uchar> mask;
+            cv::Matx33d R;
+            cv::Vec3d t;
+            findPoseRansac(scene.points3D, scene.points_L2, K64, mask, R, t, false, 3., .99, 1000);
+        });
+
+        benchmark("getRightProjectionMat", n, [&](){
+            cv::Mat E = scene.E.clone();
+            cv::Mat P;
+            vector<cv::Point3f> outCloud;
+            getRightProjectionMat(E, P, scene.K, scene.points_L1, scene.points_L2, outCloud);
+        });
+
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# explicit simd target instead of -march=native, so the binary runs on any cpu with avx (sandy bridge,
+# bulldozer and newer). the lane kernels use avx, then sse2, the hamming distance ssse3.
+# older cpus: qmake SIMD_FLAGS=-msse2
+isEmpty(SIMD_FLAGS): SIMD_FLAGS = -msse4.2 -mavx
+QMAKE_CXXFLAGS += -std=c++11 -fPIC -g -fexpensive-optimizations -D_GNULINUX -O3 $$SIMD_FLAGS
+SOURCES += \
+    Benchmark.cpp \
+    Triangulation.cpp \
+    FindCameraMatrices.cpp \
+    Ransac.cpp \
+    Utility.cpp
+
+HEADERS += \
+    Triangulation.h \
+    FindCameraMatrices.h \
+    Ransac.h \
+    SimdLanes.h \
+    Utility.h \
+    RigidTransform.h
+
+unix:!macx: LIBS += -lopencv_core \
+                    -lopencv_imgproc \
+                    -lopencv_highgui \
+                    -lopencv_calib3d \
+                    -lopencv_features2d
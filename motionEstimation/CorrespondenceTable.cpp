@@ -0,0 +1,110 @@
+#include "CorrespondenceTable.h"
+
+unsigned int CorrespondenceTable::numberOfValid() const {
+    unsigned int number = 0;
+    for (unsigned int i = 0; i < valid.size(); ++i) {
+        number += (0 != valid[i]);
+    }
+    return number;
+}
+
+void CorrespondenceTable::clear(){
+    L1.clear();
+    R1.clear();
+    L2.clear();
+    R2.clear();
+    cloud.clear();
+    quality.clear();
+    valid.clear();
+}
+
+void CorrespondenceTable::resize(unsigned int rows){
+    L1.resize(rows);
+    R1.resize(rows);
+    L2.resize(rows);
+    R2.resize(rows);
+    valid.resize(rows, 1);
+}
+
+void CorrespondenceTable::rejectUnvisible(int resX, int resY){
+    rejectUnvisiblePoints(L1, resX, resY, valid);
+    rejectUnvisiblePoints(R1, resX, resY, valid);
+    rejectUnvisiblePoints(L2, resX, resY, valid);
+    rejectUnvisiblePoints(R2, resX, resY, valid);
+}
+
+void CorrespondenceTable::compact(){
+    compactByMask(L1, valid);
+    compactByMask(R1, valid);
+    compactByMask(L2, valid);
+    compactByMask(R2, valid);
+    if (!cloud.empty()) {
+        compactByMask(cloud, valid);
+    }
+    if (!quality.empty()) {
+        compactByMask(quality, valid);
+    }
+    valid.assign(L1.size(), 1);
+}
+
+void CorrespondenceTable::copyValid(CorrespondenceTable& out) const {
+    unsigned int rows = numberOfValid();
+    out.clear();
+    out.L1.reserve(rows);
+    out.R1.reserve(rows);
+    out.L2.reserve(rows);
+    out.R2.reserve(rows);
+
+    bool withCloud = (cloud.size() == valid.size() && !cloud.empty());
+    if (withCloud) {
+        out.cloud.reserve(rows);
+    }
+    bool withQuality = (quality.size() == valid.size() && !quality.empty());
+    if (withQuality) {
+        out.quality.reserve(rows);
+    }
+
+    for (unsigned int i = 0; i < valid.size(); ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+        out.L1.push_back(L1[i]);
+        out.R1.push_back(R1[i]);
+        out.L2.push_back(L2[i]);
+        out.R2.push_back(R2[i]);
+        if (withCloud) {
+            out.cloud.push_back(cloud[i]);
+        }
+        if (withQuality) {
+            out.quality.push_back(quality[i]);
+        }
+    }
+    out.valid.assign(rows, 1);
+}
+
+void rejectZeroPoints(const vector<cv::Point2f>& points, vector<uchar>& valid){
+    unsigned int size = std::min(points.size(), valid.size());
+    for (unsigned int i = 0; i < size; ++i) {
+        if (0 == points[i].x && 0 == points[i].y) {
+            valid[i] = 0;
+        }
+    }
+}
+
+void rejectZeroPoints(const vector<cv::Point3f>& points, vector<uchar>& valid){
+    unsigned int size = std::min(points.size(), valid.size());
+    for (unsigned int i = 0; i < size; ++i) {
+        if (0 == points[i].x && 0 == points[i].y) {
+            valid[i] = 0;
+        }
+    }
+}
+
+void rejectUnvisiblePoints(const vector<cv::Point2f>& points, int resX, int resY, vector<uchar>& valid){
+    unsigned int size = std::min(points.size(), valid.size());
+    for (unsigned int i = 0; i < size; ++i) {
+        if ((1 >= points[i].x && 1 >= points[i].y) || (resX <= points[i].x && resY <= points[i].y)) {
+            valid[i] = 0;
+        }
+    }
+}
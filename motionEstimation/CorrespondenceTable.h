@@ -0,0 +1,59 @@
+#ifndef CORRESPONDENCETABLE_H
+#define CORRESPONDENCETABLE_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// all views of the features tracked from stereo 1 into stereo 2. row i of every column is the
+// same feature. filters do not mark rejected points as (0,0) anymore, they clear valid[i]
+// (a filter only looks at the rows that are still valid). compact() drops the rejected rows
+// of all columns in one stable pass.
+class CorrespondenceTable {
+public:
+    vector<cv::Point2f> L1, R1, L2, R2;
+    vector<cv::Point3f> cloud;          // empty or one point per row
+    vector<float> quality;              // empty or one value per row, higher is better (PROSAC order)
+    vector<uchar> valid;
+
+    unsigned int size() const { return L1.size(); }
+    unsigned int numberOfValid() const;
+
+    void clear();
+    // resize all image point columns (and valid) to rows, new rows are valid
+    void resize(unsigned int rows);
+
+    // same test as deleteUnvisiblePoints
+    void rejectUnvisible(int resX, int resY);
+
+    void compact();
+    // valid rows into out (out is compact afterwards), this table stays untouched
+    void copyValid(CorrespondenceTable& out) const;
+};
+
+// clear valid[i] if points[i] is (0,0), the sentinel of the old filters. (for Point3f: x and y are 0)
+void rejectZeroPoints(const vector<cv::Point2f>& points, vector<uchar>& valid);
+void rejectZeroPoints(const vector<cv::Point3f>& points, vector<uchar>& valid);
+
+// clear valid[i] if points[i] lies in the top left corner (x <= 1 and y <= 1) or beyond the bottom right one
+void rejectUnvisiblePoints(const vector<cv::Point2f>& points, int resX, int resY, vector<uchar>& valid);
+
+// keep values[i] with valid[i] != 0, stable and O(n)
+template <typename T>
+void compactByMask(vector<T>& values, const vector<uchar>& valid){
+    unsigned int size = std::min(values.size(), valid.size());
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < size; ++i) {
+        if (valid[i]) {
+            if (kept != i) {
+                values[kept] = values[i];
+            }
+            ++kept;
+        }
+    }
+    values.resize(kept);
+}
+
+#endif // CORRESPONDENCETABLE_H
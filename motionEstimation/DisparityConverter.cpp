@@ -0,0 +1,43 @@
+#include "DisparityMap.h"
+#include "Utility.h"
+
+#include <vector>
+
+// converts all disparity/disparity_<n>.yml files of a sequence to the binary
+// disparity format (disparity_<n>.disp), see DisparityMap.h
+// usage: DisparityConverter [sequence path]   (default: path of data/config.yml)
+
+int main(int argc, char** argv){
+    string dataPath;
+    if (1 < argc) {
+        dataPath = argv[1];
+    } else {
+        cv::FileStorage config("data/config.yml", cv::FileStorage::READ);
+        config["path"] >> dataPath;
+        config.release();
+    }
+
+    std::vector<string> filenames;
+    if (0 != getFiles(dataPath + "disparity/", filenames)) {
+        return 1;
+    }
+
+    int converted = 0;
+    for (unsigned int i = 0; i < filenames.size(); ++i) {
+        const string& name = filenames[i];
+        if (4 > name.size() || ".yml" != name.substr(name.size() - 4)) {
+            continue;
+        }
+
+        string ymlFile = dataPath + "disparity/" + name;
+        string binaryFile = dataPath + "disparity/" + name.substr(0, name.size() - 4) + ".disp";
+        if (convertDisparityMap(ymlFile, binaryFile)) {
+            ++converted;
+        } else {
+            std::cout << "Could not convert " << ymlFile << std::endl;
+        }
+    }
+
+    std::cout << "converted " << converted << " disparity maps" << std::endl;
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "DisparityMap.h"
+
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char DISPARITY_MAGIC[4] = {'D','S','P','1'};
+
+bool writeDisparityMap(const string& file, const cv::Mat& disparity, const cv::Mat& Q){
+    if (disparity.empty()) {
+        return false;
+    }
+
+    cv::Mat disparity16S;
+    disparity.convertTo(disparity16S, CV_16S);
+
+    DisparityHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISPARITY_MAGIC, sizeof(header.magic));
+    header.rows = disparity16S.rows;
+    header.cols = disparity16S.cols;
+    header.type = CV_16S;
+    if (!Q.empty()) {
+        cv::Mat_<double> Q64F;
+        Q.convertTo(Q64F, CV_64F);
+        for (unsigned int i = 0; i < 16; ++i) {
+            header.Q[i] = Q64F(i/4, i%4);
+        }
+    }
+
+    std::ofstream stream(file.c_str(), std::ios::binary);
+    if (!stream) {
+        return false;
+    }
+
+    stream.write((const char*)&header, sizeof(header));
+    for (int y = 0; y < disparity16S.rows; ++y) {
+        stream.write((const char*)disparity16S.ptr<short>(y), disparity16S.cols * sizeof(short));
+    }
+
+    return stream.good();
+}
+
+bool convertDisparityMap(const string& ymlFile, const string& binaryFile){
+    cv::Mat disparity, Q;
+    cv::FileStorage fs(ymlFile, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        return false;
+    }
+    fs["disparity"] >> disparity;
+    fs["Q"] >> Q;
+    fs.release();
+
+    return writeDisparityMap(binaryFile, disparity, Q);
+}
+
+MappedDisparityMap::MappedDisparityMap()
+    : _data(0), _size(0)
+{
+}
+
+MappedDisparityMap::MappedDisparityMap(const string& file)
+    : _data(0), _size(0)
+{
+    open(file);
+}
+
+MappedDisparityMap::~MappedDisparityMap(){
+    close();
+}
+
+bool MappedDisparityMap::open(const string& file){
+    close();
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (0 > fd) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (0 != fstat(fd, &fileStat) || (size_t)fileStat.st_size < sizeof(DisparityHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data) {
+        return false;
+    }
+
+    const DisparityHeader* header = (const DisparityHeader*)data;
+    size_t payload = (size_t)header->rows * header->cols * sizeof(short);
+    if (0 != memcmp(header->magic, DISPARITY_MAGIC, sizeof(header->magic)) || CV_16S != header->type ||
+            0 > header->rows || 0 > header->cols ||
+            (size_t)fileStat.st_size < sizeof(DisparityHeader) + payload) {
+        std::cout << "Error: " << file << " is not a binary disparity map" << std::endl;
+        munmap(data, fileStat.st_size);
+        return false;
+    }
+
+    _data = data;
+    _size = fileStat.st_size;
+    _disparity = cv::Mat(header->rows, header->cols, CV_16S, (char*)data + sizeof(DisparityHeader));
+    _Q = cv::Mat(4, 4, CV_64F, (void*)header->Q).clone();
+
+    return true;
+}
+
+void MappedDisparityMap::close(){
+    _disparity.release();
+    _Q.release();
+
+    if (_data) {
+        munmap(_data, _size);
+        _data = 0;
+        _size = 0;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef DISPARITYMAP_H
+#define DISPARITYMAP_H
+
+#include <string>
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// binary disparity map: header followed by the raw CV_16S disparity values
+// (row major, fixed point with 4 fractional bits like cv::StereoSGBM).
+// replaces the disparity_<n>.yml files, which are very slow to parse.
+struct DisparityHeader {
+    char magic[4];      // "DSP1"
+    int32_t rows;
+    int32_t cols;
+    int32_t type;       // always CV_16S
+    double Q[16];       // reprojection matrix of cv::stereoRectify
+};
+
+bool writeDisparityMap(const string& file, const cv::Mat& disparity, const cv::Mat& Q);
+
+// convert disparity_<n>.yml (nodes "disparity" and "Q") to the binary format
+bool convertDisparityMap(const string& ymlFile, const string& binaryFile);
+
+// read only view on a memory mapped binary disparity map. disparity() is a
+// cv::Mat header on the mapped file, nothing is copied or parsed.
+class MappedDisparityMap {
+public:
+    MappedDisparityMap();
+    MappedDisparityMap(const string& file);
+    ~MappedDisparityMap();
+
+    bool open(const string& file);
+    void close();
+    bool isOpen() const { return 0 != _data; }
+
+    const cv::Mat& disparity() const { return _disparity; }
+    const cv::Mat& Q() const { return _Q; }
+
+private:
+    MappedDisparityMap(const MappedDisparityMap&);
+    MappedDisparityMap& operator=(const MappedDisparityMap&);
+
+    void* _data;
+    size_t _size;
+    cv::Mat _disparity;
+    cv::Mat _Q;
+};
+
+#endif // DISPARITYMAP_H
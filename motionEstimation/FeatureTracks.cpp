@@ -0,0 +1,116 @@
+#include "FeatureTracks.h"
+#include "Timing.h"
+
+void FeatureTracks::Tracks::clear(int frame){
+    this->frame = frame;
+    points_L.clear();
+    points_R.clear();
+    ids.clear();
+    ages.clear();
+}
+
+FeatureTracks::FeatureTracks(unsigned int minTracks, int maxFeatures, float minQualityLevel, float minDistance)
+    : _nextId(0),
+      _minTracks(minTracks),
+      _maxFeatures(maxFeatures),
+      _minQualityLevel(minQualityLevel),
+      _minDistance(minDistance),
+      _rectified(false),
+      _minDisparity(0),
+      _maxDisparity(0)
+{
+    _current.clear(-1);
+    _next.clear(-1);
+}
+
+void FeatureTracks::setRectified(int minDisparity, int maxDisparity){
+    _rectified = true;
+    _minDisparity = minDisparity;
+    _maxDisparity = maxDisparity;
+}
+
+void FeatureTracks::prepare(ThreadPool& pool, int frame, const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Mat>& pyramid_L, const vector<cv::Mat>& pyramid_R){
+    if (_next.frame == frame) {
+        // tracks of the last accepted frame pair
+        std::swap(_current, _next);
+        _next.clear(-1);
+    } else if (_current.frame != frame) {
+        // tracks belong to another frame (e.g. stereo 2 couldn't be loaded)
+        _current.clear(frame);
+    }
+
+    if (_current.points_L.size() < _minTracks) {
+        topUp(pool, image_L, image_R, pyramid_L, pyramid_R);
+    }
+}
+
+void FeatureTracks::topUp(ThreadPool& pool, const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Mat>& pyramid_L, const vector<cv::Mat>& pyramid_R){
+    int number = _maxFeatures - _current.points_L.size();
+    if (0 >= number) {
+        return;
+    }
+
+    // don't detect features next to already tracked points
+    cv::Mat mask(image_L.size(), CV_8UC1, cv::Scalar(255));
+    for (unsigned int i = 0; i < _current.points_L.size(); ++i) {
+        cv::circle(mask, _current.points_L[i], _minDistance, cv::Scalar(0), -1);
+    }
+
+    std::vector<cv::Point2f> features;
+    {
+        StageTimer timer("getStrongFeaturePoints");
+        features = getStrongFeaturePoints(pool, image_L, mask, number, _minQualityLevel, _minDistance);
+    }
+    if (features.empty()) {
+        return;
+    }
+
+    std::vector<cv::Point2f> points_L, points_R;
+    std::vector<uchar> found;
+    if (_rectified) {
+        StageTimer timer("refindFeaturePointsRectified");
+        refindFeaturePointsRectified(image_L, image_R, features, points_L, points_R, found, _minDisparity, _maxDisparity);
+    } else {
+        StageTimer timer("refindFeaturePoints stereo");
+        refindFeaturePoints(pyramid_L, pyramid_R, features, points_L, points_R, found);
+    }
+
+    for (unsigned int i = 0; i < points_L.size(); ++i) {
+        if (!found[i]) {
+            continue;
+        }
+        _current.points_L.push_back(points_L[i]);
+        _current.points_R.push_back(points_R[i]);
+        _current.ids.push_back(_nextId++);
+        _current.ages.push_back(0);
+    }
+}
+
+void FeatureTracks::advance(int frame, const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R, const vector<uchar>& found, int resX, int resY){
+    _next.clear(frame);
+
+    if (points_L.empty() || points_L.size() != _current.points_L.size() || points_R.size() != _current.points_R.size() ||
+            found.size() != points_L.size()) {
+        return;
+    }
+
+    // tracked points still have to be a valid stereo correspondence
+    std::vector<uchar> valid(found);
+    getInliersFromHorizontalDirection(points_L, points_R, valid);
+
+    for (unsigned int i = 0; i < points_L.size(); ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+
+        if (1 >= points_L[i].x || 1 >= points_L[i].y || resX <= points_L[i].x || resY <= points_L[i].y ||
+                1 >= points_R[i].x || 1 >= points_R[i].y || resX <= points_R[i].x || resY <= points_R[i].y) {
+            continue;
+        }
+
+        _next.points_L.push_back(points_L[i]);
+        _next.points_R.push_back(points_R[i]);
+        _next.ids.push_back(_current.ids[i]);
+        _next.ages.push_back(_current.ages[i] + 1);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef FEATURETRACKS_H
+#define FEATURETRACKS_H
+
+#include "FindPoints.h"
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// stereo feature tracks (left and right image point of the same feature) that
+// survive from one frame to the next. Instead of detecting new features in
+// every frame, the points tracked into stereo 2 are used as stereo 1 of the
+// next frame. New features are only detected if too less tracks survive.
+class FeatureTracks {
+public:
+    FeatureTracks(unsigned int minTracks = 50, int maxFeatures = 100, float minQualityLevel = 0.001, float minDistance = 20);
+
+    // rectified rig: new detections are matched along the same row of the right image
+    // (refindFeaturePointsRectified) instead of LK left -> right
+    void setRectified(int minDisparity, int maxDisparity);
+
+    // get the tracks of frame: use the tracks carried over to this frame (see advance())
+    // and top up with new detections (tile parallel min eigenvalue corners on the pool + LK or scanline
+    // match left -> right) if there are less than minTracks. pyramids are built by buildFeaturePyramid()
+    void prepare(ThreadPool& pool, int frame, const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Mat>& pyramid_L, const vector<cv::Mat>& pyramid_R);
+
+    // carry the current tracks over into frame. points_L / points_R are aligned with
+    // points_L() / points_R(), found is 0 if the point was not found (see refindFeaturePoints).
+    // the current tracks stay untouched, so a frame can be tracked again if it is skipped.
+    void advance(int frame, const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R, const vector<uchar>& found, int resX, int resY);
+
+    const vector<cv::Point2f>& points_L() const { return _current.points_L; }
+    const vector<cv::Point2f>& points_R() const { return _current.points_R; }
+    const vector<int>& ids() const { return _current.ids; }
+    const vector<int>& ages() const { return _current.ages; }
+    unsigned int size() const { return _current.points_L.size(); }
+
+private:
+    struct Tracks {
+        int frame;
+        vector<cv::Point2f> points_L;
+        vector<cv::Point2f> points_R;
+        vector<int> ids;
+        vector<int> ages;
+
+        void clear(int frame);
+    };
+
+    void topUp(ThreadPool& pool, const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Mat>& pyramid_L, const vector<cv::Mat>& pyramid_R);
+
+    Tracks _current;
+    Tracks _next;
+    int _nextId;
+
+    unsigned int _minTracks;
+    int _maxFeatures;
+    float _minQualityLevel;
+    float _minDistance;
+
+    bool _rectified;
+    int _minDisparity;
+    int _maxDisparity;
+};
+
+#endif // FEATURETRACKS_H
@@ -1,7 +1,155 @@
 #include "FindCameraMatrices.h"
+#include "Ransac.h"
 #include "Triangulation.h"
 
 
+namespace {
+
+// rows of point (u,v) in camera P
+inline void triangulationRows(const cv::Matx34d& P, double u, double v, double a[2][4]){
+    for (int k = 0; k < 4; ++k) {
+        a[0][k] = u * P(2,k) - P(0,k);
+        a[1][k] = v * P(2,k) - P(1,k);
+    }
+}
+
+inline cv::Matx34d composeCalibratedProjection(const cv::Matx33d& K, const cv::Matx33d& R, const cv::Vec3d& t){
+    cv::Matx34d P;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            P(r,c) = K(r,0)*R(0,c) + K(r,1)*R(1,c) + K(r,2)*R(2,c);
+        }
+        P(r,3) = K(r,0)*t(0) + K(r,1)*t(1) + K(r,2)*t(2);
+    }
+    return P;
+}
+
+}
+
+int selectPoseHypothesis(const cv::Matx33d& K, const cv::Matx33d R[4], const cv::Vec3d t[4], const bool valid[4],
+                         const vector<cv::Point2f>& points2D_1, const vector<cv::Point2f>& points2D_2,
+                         const int* indices, int numberOfIndices, PoseHypothesisScore scores[4])
+{
+    int numberOfPoints = indices ? numberOfIndices : std::min(points2D_1.size(), points2D_2.size());
+
+    cv::Matx34d P0 = composeCalibratedProjection(K, cv::Matx33d::eye(), cv::Vec3d(0,0,0));
+    cv::Matx34d P1[4];
+    for (int h = 0; h < 4; ++h) {
+        scores[h].inFront_0 = scores[h].inFront_1 = scores[h].inFrontBoth = 0;
+        scores[h].reprojectionError = 0;
+        if (valid[h]) {
+            P1[h] = composeCalibratedProjection(K, R[h], t[h]);
+        }
+    }
+
+    for (int i = 0; i < numberOfPoints; ++i) {
+        int index = indices ? indices[i] : i;
+        const cv::Point2f& x0 = points2D_1[index];
+        const cv::Point2f& x1 = points2D_2[index];
+
+        // rows of the first camera are the same for all hypotheses
+        double a[4][4];
+        triangulationRows(P0, x0.x, x0.y, a);
+
+        for (int h = 0; h < 4; ++h) {
+            if (!valid[h]) {
+                continue;
+            }
+
+            triangulationRows(P1[h], x1.x, x1.y, a + 2);
+            double X[3];
+            if (!solveLinearTriangulation(a, X)) {
+                continue;
+            }
+
+            // depth and reprojection in P0 = K[I|0] and P1 = K[R|t]
+            double p0[3], p1[3];
+            for (int r = 0; r < 3; ++r) {
+                p0[r] = P0(r,0)*X[0] + P0(r,1)*X[1] + P0(r,2)*X[2] + P0(r,3);
+                p1[r] = P1[h](r,0)*X[0] + P1[h](r,1)*X[1] + P1[h](r,2)*X[2] + P1[h](r,3);
+            }
+            double z0 = X[2];
+            double z1 = R[h](2,0)*X[0] + R[h](2,1)*X[1] + R[h](2,2)*X[2] + t[h](2);
+
+            scores[h].inFront_0 += (0 < z0);
+            scores[h].inFront_1 += (0 < z1);
+            if (!(0 < z0 && 0 < z1 && 0 < p0[2] && 0 < p1[2])) {
+                continue;
+            }
+            ++scores[h].inFrontBoth;
+            scores[h].reprojectionError += std::sqrt((p0[0]/p0[2] - x0.x)*(p0[0]/p0[2] - x0.x) + (p0[1]/p0[2] - x0.y)*(p0[1]/p0[2] - x0.y)) +
+                                           std::sqrt((p1[0]/p1[2] - x1.x)*(p1[0]/p1[2] - x1.x) + (p1[1]/p1[2] - x1.y)*(p1[1]/p1[2] - x1.y));
+        }
+    }
+
+    int winner = -1;
+    for (int h = 0; h < 4; ++h) {
+        if (!valid[h] || 0 == numberOfPoints) {
+            continue;
+        }
+        if (0 < scores[h].inFrontBoth) {
+            scores[h].reprojectionError /= 2 * scores[h].inFrontBoth;
+        }
+
+        // same limit as positionCheck
+        if (scores[h].inFront_0 < 0.55 * numberOfPoints || scores[h].inFront_1 < 0.55 * numberOfPoints) {
+            continue;
+        }
+        if (-1 == winner || scores[h].inFrontBoth > scores[winner].inFrontBoth ||
+                (scores[h].inFrontBoth == scores[winner].inFrontBoth && scores[h].reprojectionError < scores[winner].reprojectionError)) {
+            winner = h;
+        }
+    }
+
+    return winner;
+}
+
+int getSpreadSubsample(const vector<cv::Point2f>& points, int gridX, int gridY, int* indices){
+    const int MAX_CELLS = 256;
+    if (points.empty() || 0 >= gridX || 0 >= gridY || MAX_CELLS < gridX * gridY) {
+        return 0;
+    }
+
+    float minX = points[0].x, maxX = points[0].x, minY = points[0].y, maxY = points[0].y;
+    for (unsigned int i = 1; i < points.size(); ++i) {
+        minX = std::min(minX, points[i].x);
+        maxX = std::max(maxX, points[i].x);
+        minY = std::min(minY, points[i].y);
+        maxY = std::max(maxY, points[i].y);
+    }
+    float cellWidth = std::max(1e-3f, (maxX - minX) / gridX);
+    float cellHeight = std::max(1e-3f, (maxY - minY) / gridY);
+
+    // indices holds the best point of each cell, -1 if empty
+    int numberOfCells = gridX * gridY;
+    float distance[MAX_CELLS];
+    for (int c = 0; c < numberOfCells; ++c) {
+        indices[c] = -1;
+    }
+
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        int cx = std::min(gridX - 1, (int)((points[i].x - minX) / cellWidth));
+        int cy = std::min(gridY - 1, (int)((points[i].y - minY) / cellHeight));
+        int c = cy * gridX + cx;
+
+        float dx = points[i].x - (minX + (cx + 0.5f) * cellWidth);
+        float dy = points[i].y - (minY + (cy + 0.5f) * cellHeight);
+        float d = dx*dx + dy*dy;
+        if (-1 == indices[c] || d < distance[c]) {
+            indices[c] = i;
+            distance[c] = d;
+        }
+    }
+
+    int count = 0;
+    for (int c = 0; c < numberOfCells; ++c) {
+        if (-1 != indices[c]) {
+            indices[count++] = indices[c];
+        }
+    }
+    return count;
+}
+
 bool getRightProjectionMat( cv::Mat& E,
                             cv::Mat& P1,
                             const cv::Mat& K,
@@ -9,13 +157,6 @@ bool getRightProjectionMat( cv::Mat& E,
                             const vector<cv::Point2f>& points2D_2,
                             std::vector<cv::Point3f>& outCloud)
 {
-    // no rotation or translation for the left projection matrix
-    //projection matrix of first camera P0 = K[I|0]
-    cv::Mat P0 = (cv::Mat_<float>(3,4) <<
-                  1.0, 0.0, 0.0, 0.0,
-                  0.0, 1.0, 0.0, 0.0,
-                  0.0, 0.0, 1.0, 0.0 );
-
     //according to http://en.wikipedia.org/wiki/Essential_matrix#Properties_of_the_essential_matrix
     if(fabsf(determinant(E)) > 5) { // > 1e-03
         cout << "det(E) != 0 : " << determinant(E) << "\n";
@@ -28,81 +169,84 @@ bool getRightProjectionMat( cv::Mat& E,
     cv::Mat_<float> t2(1,3);
 
     //decompose E to P1 , HZ (9.19)
-    {
-        // validation of E
-        bool ValidationOfE = DecomposeEtoRandT(E,R1,R2,t1,t2);     // extract cameras [R|t]
-        if (!ValidationOfE) return false;
-        if(determinant(R1)+1.0 < 1e-03 || determinant(R2)+1.0 < 1e-03) {
-            //according to http://en.wikipedia.org/wiki/Essential_matrix#Showing_that_it_is_valid
-            cout << "det(R) == -1 ["<<determinant(R1)<<"]: flip E's sign" << endl;
-            E = -E;
-            DecomposeEtoRandT(E,R1,R2,t1,t2);
-        }
-        if (!CheckCoherentRotation(R1) && !CheckCoherentRotation(R2)) {
-            cout << "det(R) != +-1.0, this is not a rotation matrix" << endl;
-            return false;
-        }
-
-        std::vector<cv::Mat_<float>> Rotations{R1,R2};
-        std::vector<cv::Mat_<float>> Translations{t1,t2};
-
-        int counter = 0;
-        std::vector<cv::Point3f> pcloud;
-        bool foundPerspectiveMatrix = false;
-
-        // find right solution of 4 possible translations and rotations
-        for (unsigned int i = 0; i < 2; ++i) {
+    // validation of E
+    bool ValidationOfE = DecomposeEtoRandT(E,R1,R2,t1,t2);     // extract cameras [R|t]
+    if (!ValidationOfE) return false;
+    if(determinant(R1)+1.0 < 1e-03 || determinant(R2)+1.0 < 1e-03) {
+        //according to http://en.wikipedia.org/wiki/Essential_matrix#Showing_that_it_is_valid
+        cout << "det(R) == -1 ["<<determinant(R1)<<"]: flip E's sign" << endl;
+        E = -E;
+        DecomposeEtoRandT(E,R1,R2,t1,t2);
+    }
+    if (!CheckCoherentRotation(R1) && !CheckCoherentRotation(R2)) {
+        cout << "det(R) != +-1.0, this is not a rotation matrix" << endl;
+        return false;
+    }
 
-            if (foundPerspectiveMatrix){
-                break;
+    // the 4 possible solutions: (R1,t1) (R1,t2) (R2,t1) (R2,t2)
+    cv::Mat_<float> Rotations[2] = {R1, R2};
+    cv::Mat_<float> Translations[2] = {t1, t2};
+    cv::Matx33d R[4];
+    cv::Vec3d t[4];
+    bool valid[4];
+    for (unsigned int i = 0; i < 2; ++i) {
+        bool coherent = CheckCoherentRotation(Rotations[i]);
+        if (!coherent) {
+            cout << "resulting rotation R is not coherent\n";
+        }
+        for (unsigned int j = 0; j < 2; ++j) {
+            int h = 2*i + j;
+            valid[h] = coherent;
+            for (int k = 0; k < 9; ++k) {
+                R[h].val[k] = Rotations[i](k / 3, k % 3);
             }
-
-            cv::Mat_<float> R = Rotations[i];
-            if (!CheckCoherentRotation(R)) {
-                cout << "resulting rotation R is not coherent\n";
-                counter += 2;
-                continue;
+            for (int k = 0; k < 3; ++k) {
+                t[h](k) = Translations[j](k);
             }
+        }
+    }
 
-            for (unsigned int j = 0; j < 2; ++j) {
-                pcloud.clear();
-                cv::Mat_<float> T = Translations[j];
-                //cout << "\n************ Testing P"<< i<<j<< " **************" << endl;
-
-                //projection matrix of second camera: P1  = K[R|t]
-                composeProjectionMat(T, R, P1);
-
-                // calibrate projection Mat
-                cv::Mat PK_0 = K * P0;
-                cv::Mat PK_1 = K * P1;
-
-                //triangulate from Richard Hartley and Andrew Zisserman
-                TriangulatePointsHZ(PK_0, PK_1, points2D_1, points2D_2, 20, pcloud);
+    cv::Matx33d K_;
+    for (int k = 0; k < 9; ++k) {
+        K_.val[k] = K.at<float>(k / 3, k % 3);
+    }
 
-                float reproj_error_L = calculateReprojectionErrorHZ(PK_0, points2D_1, pcloud);
-                float reproj_error_R = calculateReprojectionErrorHZ(PK_1, points2D_2, pcloud);
+    // find right solution of 4 possible translations and rotations: score them on a spread
+    // subsample first, only if that is not decisive on all points (in front of both cameras)
+    const int GRID_X = 6, GRID_Y = 4;
+    int subsample[GRID_X * GRID_Y];
+    int numberOfSamples = getSpreadSubsample(points2D_1, GRID_X, GRID_Y, subsample);
 
-                //check if pointa are triangulated --in front-- of both cameras. If yes break loop
-                if (positionCheck(P0, pcloud) && positionCheck(P1, pcloud)) {
-                    //cout << "############## use this perspective Matrix " << "P"<< i << j << "################" << endl;
-                    //cout << "HZ: reprojection ERROR:  left:  " <<  reproj_error_L << "  right  " << reproj_error_R << endl;
-                    foundPerspectiveMatrix = true;
-                    break;
-                }
-                ++counter;
-            }
-        }
+    PoseHypothesisScore scores[4];
+    int winner = selectPoseHypothesis(K_, R, t, valid, points2D_1, points2D_2, subsample, numberOfSamples, scores);
 
-        if (4 == counter) {
-            cout << "NO MOVEMENT: Can't find any right perspective Mat" << endl;
-            return false;
+    int candidates = 0;
+    for (int h = 0; h < 4; ++h) {
+        if (valid[h] && scores[h].inFront_0 >= 0.55 * numberOfSamples && scores[h].inFront_1 >= 0.55 * numberOfSamples) {
+            ++candidates;
         }
+    }
+    if (1 != candidates || 8 > numberOfSamples) {
+        winner = selectPoseHypothesis(K_, R, t, valid, points2D_1, points2D_2, 0, 0, scores);
+    }
 
-        for (unsigned int i=0; i<pcloud.size(); i++) {
-            outCloud.push_back(pcloud[i]);
-        }
+    if (-1 == winner) {
+        cout << "NO MOVEMENT: Can't find any right perspective Mat" << endl;
+        return false;
     }
 
+    //projection matrix of second camera: P1  = [R|t]
+    composeProjectionMat(Translations[winner % 2], Rotations[winner / 2], P1);
+
+    // point cloud of the winner (all points)
+    cv::Mat P0 = (cv::Mat_<float>(3,4) <<
+                  1.0, 0.0, 0.0, 0.0,
+                  0.0, 1.0, 0.0, 0.0,
+                  0.0, 0.0, 1.0, 0.0 );
+    std::vector<cv::Point3f> pcloud;
+    TriangulatePointsHZ(K * P0, K * P1, points2D_1, points2D_2, 0, pcloud);
+    outCloud.insert(outCloud.end(), pcloud.begin(), pcloud.end());
+
     return true;
 }
 
@@ -210,55 +354,145 @@ bool CheckCoherentRotation(cv::Mat const& R) {
 }
 
 bool getFundamentalMatrix(vector<cv::Point2f>  const& points1, vector<cv::Point2f> const& points2, vector<cv::Point2f> *inliers1, vector<cv::Point2f> *inliers2, cv::Mat& F) {
+    std::vector<uchar> valid(points1.size(), 1);
+    if (!getFundamentalMatrix(points1, points2, valid, F)) {
+        return false;
+    }
+
+    for(unsigned i = 0; i<points1.size(); ++i){
+        if (valid[i]) {
+            inliers1->push_back(points1[i]);
+            inliers2->push_back(points2[i]);
+        } else {
+            inliers1->push_back(cv::Point2f(0,0));
+            inliers2->push_back(cv::Point2f(0,0));
+        }
+    }
+
+   return true;
+}
+
+bool getFundamentalMatrix(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, vector<uchar>& valid, cv::Mat& F, const vector<float>* quality) {
     // Compute F matrix using RANSAC
-    if(points1.size() != points2.size() || 0 == points1.size()){
+    if(points1.size() != points2.size() || points1.size() != valid.size() || 0 == points1.size()){
         return false;
     }
 
-    //vector<cv::Point2f> p1;
-    //vector<cv::Point2f> p2;
+    // only the valid rows take part
+    vector<int> rows;
+    rows.reserve(points1.size());
+    for (unsigned int i = 0; i < valid.size(); ++i) {
+        if (valid[i]) {
+            rows.push_back(i);
+        }
+    }
 
-    std::vector<uchar> inliers_fundamental(points1.size(),0);
-    F = cv::findFundamentalMat(
-                cv::Mat(points1), cv::Mat(points2),   // matching points
-                inliers_fundamental,                             // match status (inlier ou outlier)
-                cv::FM_RANSAC,                                   // RANSAC method
-                5.,                                              // distance to epipolar line
-                .01);                                            // confidence probability
+    if (rows.empty()) {
+        return false;
+    }
 
-    if(countNonZero(F) < 1) {
+    bool withQuality = (quality && quality->size() == points1.size());
+    vector<cv::Point2f> validPoints1, validPoints2;
+    vector<float> validQuality;
+    bool allValid = (rows.size() == points1.size());
+    if (!allValid) {
+        validPoints1.reserve(rows.size());
+        validPoints2.reserve(rows.size());
+        for (unsigned int i = 0; i < rows.size(); ++i) {
+            validPoints1.push_back(points1[rows[i]]);
+            validPoints2.push_back(points2[rows[i]]);
+            if (withQuality) {
+                validQuality.push_back((*quality)[rows[i]]);
+            }
+        }
+    }
+    const vector<cv::Point2f>& p1 = allValid ? points1 : validPoints1;
+    const vector<cv::Point2f>& p2 = allValid ? points2 : validPoints2;
+    const vector<float>* q = withQuality ? (allValid ? quality : &validQuality) : 0;
+
+    std::vector<uchar> inliers_fundamental;
+    cv::Matx33d F_;
+    bool found = findFundamentalMatRansac(
+                p1, p2,                                         // matching points
+                inliers_fundamental, F_,                        // match status (inlier ou outlier)
+                5.,                                             // sampson distance to the epipolar geometry
+                .99,                                            // confidence probability
+                1000,                                           // max iterations
+                q);                                             // PROSAC order
+
+    if(!found) {
         //cout << "can't find F" << endl;
+        std::fill(valid.begin(), valid.end(), 0);
         return false;
     }
 
-    //check x' * F * x = 0 ??
-    vector<cv::Point3f> homogenouse1;
-    vector<cv::Point3f> homogenouse2;
-    cv::convertPointsToHomogeneous(points1, homogenouse1);
-    cv::convertPointsToHomogeneous(points2, homogenouse2);
-
-    F.convertTo(F, CV_32F);
+    cv::Mat(F_).convertTo(F, CV_32F);
 
     //get Inlier
-    for(unsigned i = 0; i<points1.size(); ++i){
-        if (inliers_fundamental[i] == 1) {
-            cv::Mat point1 (homogenouse1[i]);
-            cv::Mat point2 (homogenouse2[i]);
-
-            cv::Mat calc = point2.t() * F * point1;
-
-            // get value of calculation point2.t() * F * point1 should be 0
-            if (calc.at<float>(0,0) <= 0.1){
-                inliers1->push_back(points1[i]);
-                inliers2->push_back(points2[i]);
-            } else {
-                inliers1->push_back(cv::Point2f(0,0));
-                inliers2->push_back(cv::Point2f(0,0));
-            }
+    for(unsigned i = 0; i<rows.size(); ++i){
+        if (!inliers_fundamental[i]) {
+            valid[rows[i]] = 0;
+        }
+    }
 
-        } else {
-            inliers1->push_back(cv::Point2f(0,0));
-            inliers2->push_back(cv::Point2f(0,0));
+   return true;
+}
+
+bool getEssentialMatrix(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, const cv::Mat& KInv, vector<uchar>& valid, cv::Mat& E, const vector<float>* quality) {
+    if(points1.size() != points2.size() || points1.size() != valid.size() || 0 == points1.size()){
+        return false;
+    }
+
+    // the valid rows in calibrated coordinates K^-1 x
+    cv::Matx33d KInv_;
+    KInv.convertTo(KInv_, CV_64F);
+    bool withQuality = (quality && quality->size() == points1.size());
+
+    vector<int> rows;
+    vector<cv::Point2f> normPoints1, normPoints2;
+    vector<float> validQuality;
+    rows.reserve(points1.size());
+    normPoints1.reserve(points1.size());
+    normPoints2.reserve(points1.size());
+    for (unsigned int i = 0; i < valid.size(); ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+        rows.push_back(i);
+        normPoints1.push_back(cv::Point2f(KInv_(0,0) * points1[i].x + KInv_(0,1) * points1[i].y + KInv_(0,2),
+                                          KInv_(1,1) * points1[i].y + KInv_(1,2)));
+        normPoints2.push_back(cv::Point2f(KInv_(0,0) * points2[i].x + KInv_(0,1) * points2[i].y + KInv_(0,2),
+                                          KInv_(1,1) * points2[i].y + KInv_(1,2)));
+        if (withQuality) {
+            validQuality.push_back((*quality)[i]);
+        }
+    }
+
+    if (rows.empty()) {
+        return false;
+    }
+
+    std::vector<uchar> inliers_essential;
+    cv::Matx33d E_;
+    bool found = findEssentialMatRansac(
+                normPoints1, normPoints2,                       // calibrated matching points
+                inliers_essential, E_,                          // match status (inlier ou outlier)
+                5. * std::sqrt(KInv_(0,0) * KInv_(1,1)),        // 5 pixel sampson distance in calibrated coordinates
+                .999,                                           // confidence probability
+                1000,                                           // max iterations
+                withQuality ? &validQuality : 0);               // PROSAC order
+
+    if(!found) {
+        std::fill(valid.begin(), valid.end(), 0);
+        return false;
+    }
+
+    cv::Mat(E_).convertTo(E, CV_32F);
+
+    //get Inlier
+    for(unsigned i = 0; i<rows.size(); ++i){
+        if (!inliers_essential[i]) {
+            valid[rows[i]] = 0;
         }
     }
 
@@ -266,6 +500,7 @@ bool getFundamentalMatrix(vector<cv::Point2f>  const& points1, vector<cv::Point2
 }
 
 
+
 //-----------------------------------------------------------------------------
 void loadIntrinsic(string path, cv::Mat& K_L, cv::Mat& K_R, cv::Mat& distCoeff_L, cv::Mat& distCoeff_R) {
     //-----------------------------------------------------------------------------
@@ -287,48 +522,61 @@ void loadExtrinsic(string path, cv::Mat& R, cv::Mat& T, cv::Mat& E, cv::Mat& F )
     fs["F"] >> F;
     fs.release();
 }
-struct Comp{
-    Comp( const std::vector<cv::Point3f>& v ) : _v(v) {}
-    bool operator ()(cv::Point3f a, cv::Point3f b) { return cv::norm(a) < cv::norm(b); }
-    const std::vector<cv::Point3f>& _v;
-};
-
 void getScaleFactor(const cv::Mat& P0, const cv::Mat& P_LR, const cv::Mat& P_L, const cv::Mat& P_R,
                     const std::vector<cv::Point2f>& points_L1, const std::vector<cv::Point2f>& points_R1,
                     const std::vector<cv::Point2f>& points_L2, const std::vector<cv::Point2f>& points_R2,
                     float& u, float& v, std::vector<cv::Point3f>& pCloud, std::vector<cv::Point3f>& nearestPoints)
 {
-    std::vector<cv::Point3f> X_L, X_R;
     TriangulatePointsHZ(P0, P_LR, points_L1, points_R1, 0, pCloud);
-    TriangulatePointsHZ(P0, P_L , points_L1, points_L2, 0, X_L);
-    TriangulatePointsHZ(P0, P_R , points_R1, points_R2, 0, X_R);
-
-    // find 5 nearest points:
-    std::vector<cv::Point3f> temp(pCloud);
-    partial_sort( temp.begin(), temp.begin()+5, temp.end(), Comp(temp) );
+    getScaleFactor(P0, P_L, P_R, pCloud, points_L1, points_R1, points_L2, points_R2, u, v, nearestPoints);
+}
 
-    std::vector<cv::Point3f> X_5, X_L_5, X_R_5;
-    std::vector<cv::Point3f>::iterator it;
-    for(unsigned int i = 0; i < 5; ++i){
-        it = find(pCloud.begin(), pCloud.end(), temp[i]);
-        int index = it - pCloud.begin();
+void getScaleFactor(const cv::Mat& P0, const cv::Mat& P_L, const cv::Mat& P_R, const std::vector<cv::Point3f>& stereoCloud,
+                    const std::vector<cv::Point2f>& points_L1, const std::vector<cv::Point2f>& points_R1,
+                    const std::vector<cv::Point2f>& points_L2, const std::vector<cv::Point2f>& points_R2,
+                    float& u, float& v, std::vector<cv::Point3f>& nearestPoints)
+{
+    const unsigned int n = stereoCloud.size();
+    const unsigned int k = std::min(5u, n);
+    if (0 == k) {
+        u = v = 0;
+        return;
+    }
 
-        X_5.push_back(pCloud[index]);
-        nearestPoints.push_back(pCloud[index]);
-        X_L_5.push_back(X_L[index]);
-        X_R_5.push_back(X_R[index]);
+    // find 5 nearest points (by index, the cloud stays untouched)
+    vector<float> distances2(n);
+    vector<int> indices(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        distances2[i] = stereoCloud[i].dot(stereoCloud[i]);
+        indices[i] = i;
+    }
+    std::nth_element(indices.begin(), indices.begin() + (k - 1), indices.end(),
+                     [&distances2](int a, int b){ return distances2[a] < distances2[b]; });
+
+    // only the temporal rays of these points are triangulated
+    std::vector<cv::Point2f> L1_5(k), R1_5(k), L2_5(k), R2_5(k);
+    for (unsigned int i = 0; i < k; ++i) {
+        L1_5[i] = points_L1[indices[i]];
+        R1_5[i] = points_R1[indices[i]];
+        L2_5[i] = points_L2[indices[i]];
+        R2_5[i] = points_R2[indices[i]];
+        nearestPoints.push_back(stereoCloud[indices[i]]);
     }
 
+    std::vector<cv::Point3f> X_L_5, X_R_5;
+    TriangulatePointsHZ(P0, P_L, L1_5, L2_5, 0, X_L_5);
+    TriangulatePointsHZ(P0, P_R, R1_5, R2_5, 0, X_R_5);
 
     float sum_L = 0;
     float sum_R = 0;
-    for (unsigned int i = 0; i < X_5.size(); ++i) {
-        sum_L += ((cv::norm(X_5[i])*1.0) / cv::norm(X_L[i])*1.0);
-        sum_R += ((cv::norm(X_5[i])*1.0) / cv::norm(X_R[i])*1.0);
+    for (unsigned int i = 0; i < k; ++i) {
+        float norm = cv::norm(stereoCloud[indices[i]]);
+        sum_L += norm / cv::norm(X_L_5[i]);
+        sum_R += norm / cv::norm(X_R_5[i]);
     }
 
-    u = 1.0/X_5.size() * sum_L;
-    v = 1.0/X_5.size() * sum_R;
+    u = sum_L / k;
+    v = sum_R / k;
 }
 
 void getScaleFactorLeft(const cv::Mat& P0, const cv::Mat& P_LR, const cv::Mat& P_L,
@@ -13,9 +13,39 @@ using namespace std;
 
 bool positionCheck(const cv::Matx34f& P, const vector<cv::Point3f>& points3D);
 bool getFundamentalMatrix(const vector<cv::Point2f> &points1, const vector<cv::Point2f> &points2, vector<cv::Point2f> *inliers1, vector<cv::Point2f> *inliers2, cv::Mat& F);
+// clears valid[i] of the outliers, only the valid rows are used. all rows are invalid if no F is found.
+// quality (one value per row, higher is better) orders the RANSAC samples, see findFundamentalMatRansac
+bool getFundamentalMatrix(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, vector<uchar>& valid, cv::Mat& F, const vector<float>* quality = 0);
+// same for the essential matrix with the 5 point algorithm, the points are normalized with KInv (both views
+// of the same camera). E is the calibrated x2^T E x1 = 0, no K^T F K needed
+bool getEssentialMatrix(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, const cv::Mat& KInv, vector<uchar>& valid, cv::Mat& E, const vector<float>* quality = 0);
 bool CheckCoherentRotation(const cv::Mat& R);
 bool DecomposeEtoRandT(const cv::Mat& E, cv::Mat_<float>& R1, cv::Mat_<float>& R2, cv::Mat_<float>& t1, cv::Mat_<float>& t2);
 
+// score of one (R|t) hypothesis of the essential matrix decomposition
+struct PoseHypothesisScore {
+    int inFront_0;              // points in front of the first camera
+    int inFront_1;              // points in front of the second camera
+    int inFrontBoth;
+    double reprojectionError;   // mean over both cameras (pixel) of the points in front of both
+};
+
+// scores the four (R|t) hypotheses of P1 = K[R|t] (P0 = K[I|0]) in one pass over the
+// correspondences indices[0 .. numberOfIndices-1] (all correspondences if indices is 0):
+// linear triangulation, depth in both cameras and reprojection error, without allocations.
+// degenerate points (parallel rays) are not counted.
+// hypotheses with valid[i] == false are skipped. returns the index of the winner (most points
+// in front of both cameras, at least 55% in front of each camera, then lowest reprojection error) or -1.
+int selectPoseHypothesis(const cv::Matx33d& K, const cv::Matx33d R[4], const cv::Vec3d t[4], const bool valid[4],
+                         const vector<cv::Point2f>& points2D_1, const vector<cv::Point2f>& points2D_2,
+                         const int* indices, int numberOfIndices, PoseHypothesisScore scores[4]);
+
+// spatially spread subsample: per cell of a gridX x gridY grid over the bounding box of points
+// the index of the point closest to the cell center. indices needs gridX*gridY (at most 256)
+// entries, returns the number of indices (occupied cells).
+int getSpreadSubsample(const vector<cv::Point2f>& points, int gridX, int gridY, int* indices);
+
+// outCloud: all correspondences triangulated with the selected P1
 bool getRightProjectionMat(cv::Mat& E,
                             cv::Mat& P1, const cv::Mat &K,
                             const vector<cv::Point2f>& points2D_1,
@@ -26,6 +56,10 @@ void loadIntrinsic(string path, cv::Mat& K_L, cv::Mat& K_R, cv::Mat &distCoeff_L
 void loadExtrinsic(string path, cv::Mat& R, cv::Mat& T, cv::Mat& E, cv::Mat& F );
 
 void getScaleFactor(const cv::Mat& P0, const cv::Mat& P_LR, const cv::Mat& P_L, const cv::Mat& P_R, const vector<cv::Point2f>& points_L1, const vector<cv::Point2f>&points_R1, const vector<cv::Point2f>&points_L2, const vector<cv::Point2f>& points_R2, float& u, float& v, std::vector<cv::Point3f> &pCloud, std::vector<cv::Point3f> &nearestPoints);
+// same with the stereo cloud of points_L1 / points_R1 already triangulated (e.g. by FrameCache). u and v are
+// the mean ratio of the stereo depth to the temporal depth of the 5 nearest stereo points, only their
+// temporal rays are triangulated (P0 -> P_L for L1 / L2, P0 -> P_R for R1 / R2)
+void getScaleFactor(const cv::Mat& P0, const cv::Mat& P_L, const cv::Mat& P_R, const std::vector<cv::Point3f>& stereoCloud, const vector<cv::Point2f>& points_L1, const vector<cv::Point2f>& points_R1, const vector<cv::Point2f>& points_L2, const vector<cv::Point2f>& points_R2, float& u, float& v, std::vector<cv::Point3f>& nearestPoints);
 void getScaleFactorRight(const cv::Mat& P0, const cv::Mat& P_LR, const cv::Mat& P_R,
                     const std::vector<cv::Point2f>& points_L1, const std::vector<cv::Point2f>& points_R1,
                     const std::vector<cv::Point2f>& points_R2,
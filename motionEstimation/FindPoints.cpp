@@ -1,4 +1,13 @@
 #include "FindPoints.h"
+#include "Ransac.h"
+#include "SimdLanes.h"
+
+#include <climits>
+#include <cstring>
+#include <stdint.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 vector<cv::Point2f> getStrongFeaturePoints(const cv::Mat& image, int number, float minQualityLevel, float minDistance) {
     /* Shi and Tomasi Feature Tracking! */
@@ -23,7 +32,133 @@ vector<cv::Point2f> getStrongFeaturePoints(const cv::Mat& image, int number, flo
     return image_features;
 }
 
-void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, vector<cv::Point2f> frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2){
+vector<cv::Point2f> getStrongFeaturePoints(const cv::Mat& image, const cv::Mat& mask, int number, float minQualityLevel, float minDistance) {
+    /* same as above, but only search where mask is non-zero (e.g. away from already tracked points) */
+    vector<cv::Point2f> image_features;
+    cv::goodFeaturesToTrack(image, image_features, number, minQualityLevel, minDistance, mask);
+    return image_features;
+}
+
+// corner candidate of the tile detector
+struct Corner {
+    float score;
+    cv::Point2f point;
+};
+
+// strongest first, ties by position so the result doesn't depend on the order of the tiles
+static bool strongerCorner(const Corner& a, const Corner& b){
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.point.y != b.point.y) {
+        return a.point.y < b.point.y;
+    }
+    return a.point.x < b.point.x;
+}
+
+// greedy: take the corners in order if they are at least minDistance away from all taken ones
+static void selectCorners(const vector<Corner>& corners, unsigned int number, float minDistance, vector<Corner>& selected){
+    const float minDistance2 = minDistance * minDistance;
+    for (unsigned int i = 0; i < corners.size() && selected.size() < number; ++i) {
+        bool distant = true;
+        for (unsigned int j = 0; j < selected.size() && distant; ++j) {
+            cv::Point2f d = corners[i].point - selected[j].point;
+            distant = d.dot(d) >= minDistance2;
+        }
+        if (distant) {
+            selected.push_back(corners[i]);
+        }
+    }
+}
+
+vector<cv::Point2f> getStrongFeaturePoints(ThreadPool& pool, const cv::Mat& image, const cv::Mat& mask, int number, float minQualityLevel, float minDistance, cv::Size grid) {
+    /* same corners as goodFeaturesToTrack (min eigenvalue, 3x3 non maximum suppression, quality relative
+     * to the strongest corner), but each tile of the grid is scored in parallel and takes at most its
+     * share of number, so the features are spread over the whole image.
+     */
+    const int tiles = grid.width * grid.height;
+    const unsigned int quota = (number + tiles - 1) / tiles;
+    const int border = 3;   // sobel, block size and the 3x3 maximum
+
+    vector<cv::Rect> inner(tiles), outer(tiles);
+    for (int t = 0; t < tiles; ++t) {
+        int tx = t % grid.width, ty = t / grid.width;
+        int x0 = tx * image.cols / grid.width, x1 = (tx + 1) * image.cols / grid.width;
+        int y0 = ty * image.rows / grid.height, y1 = (ty + 1) * image.rows / grid.height;
+        inner[t] = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+        outer[t] = cv::Rect(x0 - border, y0 - border, x1 - x0 + 2 * border, y1 - y0 + 2 * border) & cv::Rect(0, 0, image.cols, image.rows);
+    }
+
+    // 1. min eigenvalue and local maxima of every tile (with a border, so the tile edges match the whole image)
+    vector<cv::Mat> eigenvalues(tiles), maxima(tiles);
+    vector<double> maxEigenvalue(tiles, 0);
+    vector<future<void> > scored;
+    for (int t = 0; t < tiles; ++t) {
+        scored.push_back(pool.enqueue([&, t]{
+            cv::cornerMinEigenVal(image(outer[t]), eigenvalues[t], 3, 3);
+            cv::dilate(eigenvalues[t], maxima[t], cv::Mat());
+            cv::Mat tile = eigenvalues[t](inner[t] - outer[t].tl());
+            cv::minMaxLoc(tile, 0, &maxEigenvalue[t]);
+        }));
+    }
+    for (int t = 0; t < tiles; ++t) {
+        scored[t].get();
+    }
+
+    const float threshold = minQualityLevel * *std::max_element(maxEigenvalue.begin(), maxEigenvalue.end());
+
+    // 2. candidates above the global quality level, strongest of each tile that keep minDistance
+    vector<vector<Corner> > selected(tiles);
+    vector<future<void> > suppressed;
+    for (int t = 0; t < tiles; ++t) {
+        suppressed.push_back(pool.enqueue([&, t]{
+            cv::Point offset = inner[t].tl() - outer[t].tl();
+            vector<Corner> corners;
+            for (int y = inner[t].y; y < inner[t].y + inner[t].height; ++y) {
+                const float* e = eigenvalues[t].ptr<float>(y - outer[t].y);
+                const float* m = maxima[t].ptr<float>(y - outer[t].y);
+                const uchar* allowed = mask.empty() ? 0 : mask.ptr<uchar>(y);
+                for (int x = offset.x; x < offset.x + inner[t].width; ++x) {
+                    if (e[x] > threshold && e[x] == m[x] && (!allowed || allowed[x + outer[t].x])) {
+                        Corner corner = {e[x], cv::Point2f(x + outer[t].x, y)};
+                        corners.push_back(corner);
+                    }
+                }
+            }
+            std::sort(corners.begin(), corners.end(), strongerCorner);
+            selectCorners(corners, quota, minDistance, selected[t]);
+        }));
+    }
+    for (int t = 0; t < tiles; ++t) {
+        suppressed[t].get();
+    }
+
+    // 3. merge, minDistance across the tile borders
+    vector<Corner> corners, merged;
+    for (int t = 0; t < tiles; ++t) {
+        corners.insert(corners.end(), selected[t].begin(), selected[t].end());
+    }
+    std::sort(corners.begin(), corners.end(), strongerCorner);
+    selectCorners(corners, number, minDistance, merged);
+
+    vector<cv::Point2f> image_features(merged.size());
+    for (unsigned int i = 0; i < merged.size(); ++i) {
+        image_features[i] = merged[i].point;
+    }
+    return image_features;
+}
+
+void buildFeaturePyramid(const cv::Mat& image, vector<cv::Mat>& pyramid){
+    /* build the pyramid once with the same window size and levels as refindFeaturePoints,
+     * so it can be passed to calcOpticalFlowPyrLK instead of the raw image.
+     */
+    cv::buildOpticalFlowPyramid(image, pyramid, LK_WINDOW_SIZE, LK_MAX_LEVEL);
+}
+
+// with found, points2 keeps the flow result of every feature and found[i] tells if it is valid
+// (and minEigenvalues the lk min eigenvalue of each feature). without, features that are not found
+// are (0,0) in points1 and points2
+static void refindFeaturePointsLK(cv::InputArray prev_image, cv::InputArray next_image, const vector<cv::Point2f>& frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2, vector<uchar>* found = 0, vector<float>* minEigenvalues = 0){
     /* Pyramidal Lucas Kanade Optical Flow! */
 
     /* This array will contain the locations of the points from frame 1 in frame 2. */
@@ -41,13 +176,13 @@ void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, v
     vector<float> optical_flow_feature_error;
 
     /* This is the window size to use to avoid the aperture problem (see slide "Optical Flow: Overview"). */
-    CvSize optical_flow_window = cvSize(5,5);
+    cv::Size optical_flow_window = LK_WINDOW_SIZE;
 
     /* 0-based maximal pyramid level number; if set to 0, pyramids are not used (single level),
      * if set to 1, two levels are used, and so on; if pyramids are passed to input then algorithm
      * will use as many levels as pyramids have but no more than maxLevel.
      * */
-    int maxLevel = 10;
+    int maxLevel = LK_MAX_LEVEL;
 
     /* This termination criteria tells the algorithm to stop when it has either done 20 iterations or when
      * epsilon is better than .3.  You can play with these parameters for speed vs. accuracy but these values
@@ -75,6 +210,16 @@ void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, v
                              optical_flow_termination_criteria, cv::OPTFLOW_LK_GET_MIN_EIGENVALS);
 
 
+    if (found) {
+        points1.insert(points1.end(), frame1_features.begin(), frame1_features.end());
+        points2.insert(points2.end(), frame2_features.begin(), frame2_features.end());
+        found->swap(optical_flow_found_feature);
+        if (minEigenvalues) {
+            minEigenvalues->swap(optical_flow_feature_error);
+        }
+        return;
+    }
+
     for (unsigned i = 0; i < frame1_features.size(); ++i){
         if ( optical_flow_found_feature[i] == 1 ){
             points1.push_back(frame1_features[i]);
@@ -86,127 +231,349 @@ void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, v
     }
 }
 
+void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, vector<cv::Point2f> frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2){
+    refindFeaturePointsLK(prev_image, next_image, frame1_features, points1, points2);
+}
+
+void refindFeaturePoints(const vector<cv::Mat>& prev_pyramid, const vector<cv::Mat>& next_pyramid, const vector<cv::Point2f>& frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2){
+    refindFeaturePointsLK(prev_pyramid, next_pyramid, frame1_features, points1, points2);
+}
+
+void refindFeaturePoints(const vector<cv::Mat>& prev_pyramid, const vector<cv::Mat>& next_pyramid, const vector<cv::Point2f>& frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2, vector<uchar>& found){
+    refindFeaturePointsLK(prev_pyramid, next_pyramid, frame1_features, points1, points2, &found);
+}
+
+// zncc of the template (zero mean, unit norm, window x window) with the windows starting at the columns
+// k .. k + lanes - 1 of strip: dot = sum(templ * strip), variance = sum((strip - mean)^2), zncc = dot / sqrt(variance)
+struct ZnccKernel {
+    const float* templ;
+    const float* strip;
+    int stripWidth;
+    int window;
+    float* dot;
+    float* variance;
+
+    template <class V>
+    void run(int k) const {
+        V d(0.), sum(0.), sum2(0.);
+        for (int r = 0; r < window; ++r) {
+            const float* row = strip + r * stripWidth + k;
+            for (int c = 0; c < window; ++c) {
+                V v = V::load(row + c);
+                d = d + V(templ[r * window + c]) * v;
+                sum = sum + v;
+                sum2 = sum2 + v * v;
+            }
+        }
+        d.store(dot + k);
+        (sum2 - sum * sum / V(window * window)).store(variance + k);
+    }
+};
+
+void refindFeaturePointsRectified(const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Point2f>& features,
+                                  vector<cv::Point2f>& points_L, vector<cv::Point2f>& points_R, vector<uchar>& found,
+                                  int minDisparity, int maxDisparity, float minCorrelation){
+    const int window = 2 * STEREO_WINDOW_RADIUS + 1;
+    const int candidates = maxDisparity - minDisparity + 1;
+    const int stripWidth = candidates + window - 1;
+    if (0 >= candidates) {
+        return;
+    }
+
+    cv::Mat templ, strip;
+    vector<float> dot(candidates), variance(candidates), correlation(candidates);
+
+    points_L.reserve(points_L.size() + features.size());
+    points_R.reserve(points_R.size() + features.size());
+    found.reserve(found.size() + features.size());
+    for (unsigned int i = 0; i < features.size(); ++i) {
+        const cv::Point2f& p = features[i];
+        bool matched = false;
+        float x_R = p.x;
+
+        // template around the feature, subpixel and border replicated
+        cv::getRectSubPix(image_L, cv::Size(window, window), p, templ, CV_32F);
+        cv::Scalar mean, deviation;
+        cv::meanStdDev(templ, mean, deviation);
+
+        if (1 < deviation[0]) {
+            templ = (templ - mean[0]) / (deviation[0] * window);
+
+            // same row of the right image, column k is the window of x_R = x_L - maxDisparity + k
+            cv::getRectSubPix(image_R, cv::Size(stripWidth, window), cv::Point2f(p.x - 0.5f * (maxDisparity + minDisparity), p.y), strip, CV_32F);
+
+            ZnccKernel kernel = {templ.ptr<float>(), strip.ptr<float>(), stripWidth, window, &dot[0], &variance[0]};
+            forEachLane(candidates, kernel);
+
+            int best = 0;
+            for (int k = 0; k < candidates; ++k) {
+                correlation[k] = (0 < variance[k]) ? dot[k] / sqrt(variance[k]) : -1;
+                if (correlation[k] > correlation[best]) {
+                    best = k;
+                }
+            }
 
-void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2, vector<cv::Point2f> &points_L1, vector<cv::Point2f>& points_R1, vector<cv::Point2f> &points_L2, vector<cv::Point2f> &points_R2) {
-    vector<cv::DMatch> matches;
+            // a maximum at the border of the disparity range is cut off, no reliable match
+            if (0 < best && candidates - 1 > best && minCorrelation <= correlation[best]) {
+                float c0 = correlation[best - 1], c1 = correlation[best], c2 = correlation[best + 1];
+                float curvature = c0 - 2 * c1 + c2;
+                float offset = (0 > curvature) ? 0.5f * (c0 - c2) / curvature : 0;
+                x_R = p.x - maxDisparity + best + offset;
+                matched = true;
+            }
+        }
 
-    vector<cv::KeyPoint>left_keypoints,right_keypoints;
+        points_L.push_back(p);
+        points_R.push_back(cv::Point2f(x_R, p.y));
+        found.push_back(matched ? 1 : 0);
+    }
+}
 
-    // Detect keypoints in the left and right images
-    cv::FastFeatureDetector ffd;
-    ffd.detect(frame_L1, left_keypoints);
-    ffd.detect(frame_R1, right_keypoints);
+void refindFeaturePoints(ThreadPool& pool,
+                         const vector<cv::Mat>& pyramid_L1, const vector<cv::Mat>& pyramid_R1,
+                         const cv::Mat& image_L2, const cv::Mat& image_R2,
+                         vector<cv::Mat>& pyramid_L2, vector<cv::Mat>& pyramid_R2,
+                         const vector<cv::Point2f>& features_L1, const vector<cv::Point2f>& features_R1,
+                         vector<cv::Point2f>& points_L1, vector<cv::Point2f>& points_R1,
+                         vector<cv::Point2f>& points_L2, vector<cv::Point2f>& points_R2)
+{
+    /* left L1 -> L2 and right R1 -> R2 tracking are independent, so run them in parallel.
+     * stereo 2 pyramids are built by the task that needs them (if they are not built yet).
+     */
+    future<void> trackLeft = pool.enqueue([&]{
+        if (pyramid_L2.empty()) {
+            buildFeaturePyramid(image_L2, pyramid_L2);
+        }
+        refindFeaturePointsLK(pyramid_L1, pyramid_L2, features_L1, points_L1, points_L2);
+    });
 
-    vector<cv::Point2f>left_points;
-    KeyPointsToPoints(left_keypoints,left_points);
+    future<void> trackRight = pool.enqueue([&]{
+        if (pyramid_R2.empty()) {
+            buildFeaturePyramid(image_R2, pyramid_R2);
+        }
+        refindFeaturePointsLK(pyramid_R1, pyramid_R2, features_R1, points_R1, points_R2);
+    });
 
-    vector<cv::Point2f>right_points(left_points.size());
+    // join before the results are used (e.g. by deleteUnvisiblePoints)
+    trackLeft.get();
+    trackRight.get();
+}
 
-    // Calculate the optical flow field:
-    //  how each left_point moved across the 2 images
-    vector<uchar>vstatus; vector<float>verror;
-    cv::calcOpticalFlowPyrLK(frame_L1, frame_R1, left_points, right_points, vstatus, verror);
+void refindFeaturePoints(ThreadPool& pool,
+                         const vector<cv::Mat>& pyramid_L1, const vector<cv::Mat>& pyramid_R1,
+                         const cv::Mat& image_L2, const cv::Mat& image_R2,
+                         vector<cv::Mat>& pyramid_L2, vector<cv::Mat>& pyramid_R2,
+                         const vector<cv::Point2f>& features_L1, const vector<cv::Point2f>& features_R1,
+                         CorrespondenceTable& correspondences)
+{
+    /* same as above, but a feature that is lost in one of both images is only marked as invalid */
+    correspondences.clear();
+    vector<uchar> found_L, found_R;
+    vector<float> minEigenvalues_L, minEigenvalues_R;
+
+    future<void> trackLeft = pool.enqueue([&]{
+        if (pyramid_L2.empty()) {
+            buildFeaturePyramid(image_L2, pyramid_L2);
+        }
+        refindFeaturePointsLK(pyramid_L1, pyramid_L2, features_L1, correspondences.L1, correspondences.L2, &found_L, &minEigenvalues_L);
+    });
 
-    // First, filter out the points with high error
-    vector<cv::Point2f>right_points_to_find;
-    vector<int>right_points_to_find_back_index;
-    for (unsigned int i=0; i<vstatus.size(); i++) {
-        if (vstatus[i] &&verror[i] < 12.0) {
-            // Keep the original index of the point in the
-            // optical flow array, for future use
-            right_points_to_find_back_index.push_back(i);
-            // Keep the feature point itself
-            right_points_to_find.push_back(right_points[i]);
-        } else {
-            vstatus[i] = 0; // a bad flow
+    future<void> trackRight = pool.enqueue([&]{
+        if (pyramid_R2.empty()) {
+            buildFeaturePyramid(image_R2, pyramid_R2);
         }
+        refindFeaturePointsLK(pyramid_R1, pyramid_R2, features_R1, correspondences.R1, correspondences.R2, &found_R, &minEigenvalues_R);
+    });
+
+    trackLeft.get();
+    trackRight.get();
+
+    correspondences.valid.resize(correspondences.size());
+    correspondences.quality.resize(correspondences.size());
+    for (unsigned int i = 0; i < correspondences.size(); ++i) {
+        correspondences.valid[i] = (found_L[i] && found_R[i]) ? 1 : 0;
+        correspondences.quality[i] = std::min(minEigenvalues_L[i], minEigenvalues_R[i]);
     }
+}
+
 
-    drawCorresPoints(frame_L1, left_points, right_points, "left right fast", cv::Scalar(255,0,0));
-
-    // for each right_point see which detected feature it belongs to
-    cv::Mat right_points_to_find_flat = cv::Mat(right_points_to_find).reshape(1,right_points_to_find.size()); //flatten array
-
-    vector<cv::Point2f>right_features; // detected features
-    KeyPointsToPoints(right_keypoints,right_features);
-
-    cv::Mat right_features_flat = cv::Mat(right_features).reshape(1,right_features.size());
-
-    //FlannBasedMatcher matcher;
-
-    // Look around each OF point in the right image
-    //  for any features that were detected in its area
-    //  and make a match.
-    cv::BFMatcher matcher(CV_L2);
-    vector<vector<cv::DMatch>>nearest_neighbors;
-    matcher.radiusMatch(
-                right_points_to_find_flat,
-                right_features_flat,
-                nearest_neighbors,
-                2.0f);
-
-    // Check that the found neighbors are unique (throw away neighbors
-    //  that are too close together, as they may be confusing)
-    std::set<int>found_in_right_points; // for duplicate prevention
-    for(int i=0;i<nearest_neighbors.size();i++) {
-        cv::DMatch _m;
-        if(nearest_neighbors[i].size()==1) {
-            _m = nearest_neighbors[i][0]; // only one neighbor
-        } else if(nearest_neighbors[i].size()>1) {
-            // 2 neighbors – check how close they are
-            float ratio = nearest_neighbors[i][0].distance / nearest_neighbors[i][1].distance;
-            if(ratio < 0.7) { // not too close
-                // take the closest (first) one
-                _m = nearest_neighbors[i][0];
-            } else { // too close – we cannot tell which is better
-                continue; // did not pass ratio test – throw away
+// number of different bits of two binary descriptors
+static inline int hammingDistance(const uchar* a, const uchar* b, int bytes){
+    int distance = 0;
+    int i = 0;
+#ifdef __SSSE3__
+    // bits of each nibble by table lookup, the bytes summed up with sad
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i sum = _mm_setzero_si128();
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        __m128i bits = _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(x, nibble)),
+                                    _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(x, 4), nibble)));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(bits, _mm_setzero_si128()));
+    }
+    distance = _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+#endif
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        distance += __builtin_popcountll(x ^ y);
+    }
+    for (; i < bytes; ++i) {
+        distance += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+// index (and hamming distance) of the best train descriptor of every query descriptor, -1 if there is none:
+// gate(q, t) has to be true, the distance at most maxDistance and smaller than ratio * second best distance
+template <class Gate>
+static void bestMatches(const cv::Mat& query, const cv::Mat& train, int maxDistance, float ratio, const Gate& gate, vector<int>& best, vector<int>& distances){
+    best.assign(query.rows, -1);
+    distances.assign(query.rows, INT_MAX);
+    for (int q = 0; q < query.rows; ++q) {
+        int distance1 = INT_MAX, distance2 = INT_MAX, index = -1;
+        for (int t = 0; t < train.rows; ++t) {
+            if (!gate(q, t)) {
+                continue;
+            }
+            int distance = hammingDistance(query.ptr<uchar>(q), train.ptr<uchar>(t), query.cols);
+            if (distance < distance1) {
+                distance2 = distance1;
+                distance1 = distance;
+                index = t;
+            } else if (distance < distance2) {
+                distance2 = distance;
             }
-        } else {
-            continue; // no neighbors... :(
         }
+        if (0 <= index && maxDistance >= distance1 && distance1 < ratio * distance2) {
+            best[q] = index;
+            distances[q] = distance1;
+        }
+    }
+}
 
-        // prevent duplicates
-        if (found_in_right_points.find(_m.trainIdx) == found_in_right_points.end()) {
-            // The found neighbor was not yet used:
-            // We should match it with the original indexing
-            // ofthe left point
-            _m.queryIdx = right_points_to_find_back_index[_m.queryIdx];
-            matches.push_back(_m); // add this match
-            found_in_right_points.insert(_m.trainIdx);
+// matches[i] is the keypoint of image 2 of keypoint i of image 1 (or -1) if both are the best match of each
+// other, distances[i] their hamming distance. with F (x2^T F x1 = 0), only pairs within threshold (sampson
+// distance, pixel) are compared
+static void crossCheckedMatches(const vector<cv::KeyPoint>& keypoints1, const cv::Mat& descriptors1,
+                                const vector<cv::KeyPoint>& keypoints2, const cv::Mat& descriptors2,
+                                const cv::Mat& F, float threshold, vector<int>& matches, vector<int>& distances){
+    const int maxDistance = 64;
+    const float ratio = 0.8;
+
+    vector<int> forward, backward, backwardDistances;
+    if (F.empty()) {
+        auto all = [](int, int){ return true; };
+        bestMatches(descriptors1, descriptors2, maxDistance, ratio, all, forward, distances);
+        bestMatches(descriptors2, descriptors1, maxDistance, ratio, all, backward, backwardDistances);
+    } else {
+        // epipolar lines F x1 and F^T x2 of all keypoints
+        cv::Matx33f F_;
+        F.convertTo(F_, CV_32F);
+        vector<cv::Vec3f> lines1(keypoints1.size()), lines2(keypoints2.size());
+        for (unsigned int i = 0; i < keypoints1.size(); ++i) {
+            lines1[i] = F_ * cv::Vec3f(keypoints1[i].pt.x, keypoints1[i].pt.y, 1);
+        }
+        for (unsigned int i = 0; i < keypoints2.size(); ++i) {
+            lines2[i] = F_.t() * cv::Vec3f(keypoints2[i].pt.x, keypoints2[i].pt.y, 1);
         }
+
+        const float threshold2 = threshold * threshold;
+        auto epipolar = [&](int i1, int i2){
+            const cv::Vec3f& l1 = lines1[i1];
+            const cv::Vec3f& l2 = lines2[i2];
+            float e = keypoints2[i2].pt.x * l1[0] + keypoints2[i2].pt.y * l1[1] + l1[2];
+            return e * e <= threshold2 * (l1[0] * l1[0] + l1[1] * l1[1] + l2[0] * l2[0] + l2[1] * l2[1]);
+        };
+        bestMatches(descriptors1, descriptors2, maxDistance, ratio, epipolar, forward, distances);
+        bestMatches(descriptors2, descriptors1, maxDistance, ratio, [&](int i2, int i1){ return epipolar(i1, i2); }, backward, backwardDistances);
     }
-    cout<<"pruned "<< matches.size() <<" / "<<nearest_neighbors.size() <<" matches"<<endl;
 
-    cv::Mat img_out;
-    cv::drawMatches(frame_L1, left_keypoints, frame_R1, right_keypoints, matches, img_out);
-    cv::imshow("test fast matches", img_out);
-    cv::waitKey();
+    matches.assign(forward.size(), -1);
+    for (unsigned int i = 0; i < forward.size(); ++i) {
+        if (0 <= forward[i] && (int)i == backward[forward[i]]) {
+            matches[i] = forward[i];
+        }
+    }
 }
 
-void getInliersFromMedianValue (const pair<vector<cv::Point2f>, vector<cv::Point2f> >& features, vector<cv::Point2f> &inliers1, vector<cv::Point2f> &inliers2){
-    vector<float> directions;
-    vector<float> lengths;
+void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2,
+                        vector<cv::Point2f>& points_L1, vector<cv::Point2f>& points_R1, vector<cv::Point2f>& points_L2, vector<cv::Point2f>& points_R2,
+                        const cv::Mat& F_LR, float epipolarThreshold, int maxFeatures, vector<float>* quality) {
+    /* ORB keypoints (FAST + rBRIEF) in all four images, matched by hamming distance with ratio test and
+     * cross check: L1 - R1 and L2 - R2 (epipolar gated by F_LR), L1 - L2 and R1 - R2. a correspondence is
+     * kept if the four matches close the loop L1 - R1 - R2 - L2 - L1.
+     */
+    cv::ORB orb(maxFeatures);
+    const cv::Mat* frames[4] = {&frame_L1, &frame_R1, &frame_L2, &frame_R2};
+    vector<cv::KeyPoint> keypoints[4];
+    cv::Mat descriptors[4];
+    for (int i = 0; i < 4; ++i) {
+        orb(*frames[i], cv::Mat(), keypoints[i], descriptors[i]);
+    }
+
+    vector<int> L1R1, L2R2, L1L2, R1R2;
+    vector<int> distancesL1R1, distancesL2R2, distancesL1L2, distancesR1R2;
+    crossCheckedMatches(keypoints[0], descriptors[0], keypoints[1], descriptors[1], F_LR, epipolarThreshold, L1R1, distancesL1R1);
+    crossCheckedMatches(keypoints[2], descriptors[2], keypoints[3], descriptors[3], F_LR, epipolarThreshold, L2R2, distancesL2R2);
+    crossCheckedMatches(keypoints[0], descriptors[0], keypoints[2], descriptors[2], cv::Mat(), 0, L1L2, distancesL1L2);
+    crossCheckedMatches(keypoints[1], descriptors[1], keypoints[3], descriptors[3], cv::Mat(), 0, R1R2, distancesR1R2);
+
+    for (unsigned int i = 0; i < L1R1.size(); ++i) {
+        int r1 = L1R1[i], l2 = L1L2[i];
+        if (0 > r1 || 0 > l2 || 0 > L2R2[l2] || L2R2[l2] != R1R2[r1]) {
+            continue;
+        }
+        points_L1.push_back(keypoints[0][i].pt);
+        points_R1.push_back(keypoints[1][r1].pt);
+        points_L2.push_back(keypoints[2][l2].pt);
+        points_R2.push_back(keypoints[3][L2R2[l2]].pt);
+        if (quality) {
+            // the worst of the four matches, fewer different bits is better
+            int distance = std::max(std::max(distancesL1R1[i], distancesL1L2[i]), std::max(distancesL2R2[l2], distancesR1R2[r1]));
+            quality->push_back(-distance);
+        }
+    }
+}
 
-    for (unsigned int i = 0; i < features.first.size(); ++i){
-        float direction = atan2( (float) (features.first[i].y - features.second[i].y) , (float) (features.first[i].x - features.second[i].x) );
-        directions.push_back(direction);
+void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2,
+                        CorrespondenceTable& correspondences, const cv::Mat& F_LR, float epipolarThreshold, int maxFeatures) {
+    correspondences.clear();
+    fastFeatureMatcher(frame_L1, frame_R1, frame_L2, frame_R2, correspondences.L1, correspondences.R1, correspondences.L2, correspondences.R2,
+                       F_LR, epipolarThreshold, maxFeatures, &correspondences.quality);
+    correspondences.valid.assign(correspondences.size(), 1);
+}
 
-        float length = sqrt( std::pow((features.first[i].y - features.second[i].y),2) + std::pow((features.first[i].x - features.second[i].x),2) );
-        lengths.push_back(length);
+void getInliersFromMedianValue (const pair<vector<cv::Point2f>, vector<cv::Point2f> >& features, vector<cv::Point2f> &inliers1, vector<cv::Point2f> &inliers2){
+    const unsigned int n = features.first.size();
+    if (0 == n) {
+        return;
     }
 
-    sort(directions.begin(), directions.end());
-    float median_direction = directions[(int)(directions.size()/2)];
+    vector<float> directions(n), lengths(n);
+    for (unsigned int i = 0; i < n; ++i){
+        float dx = features.first[i].x - features.second[i].x;
+        float dy = features.first[i].y - features.second[i].y;
+        directions[i] = atan2(dy, dx);
+        lengths[i] = sqrt(dx * dx + dy * dy);
+    }
 
-    sort(lengths.begin(),lengths.end());
-    float median_lenght = lengths[(int)(lengths.size()/2)];
+    // medians without sorting everything
+    vector<float> sorted(directions);
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    float median_direction = sorted[n / 2];
 
+    sorted = lengths;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    float median_lenght = sorted[n / 2];
 
-    for(unsigned int j = 0; j < features.first.size(); ++j)
+    inliers1.reserve(inliers1.size() + n);
+    inliers2.reserve(inliers2.size() + n);
+    for(unsigned int j = 0; j < n; ++j)
     {
-        float direction = atan2( (float) (features.first[j].y - features.second[j].y) , (float) (features.first[j].x - features.second[j].x) );
-        float length = sqrt( std::pow((features.first[j].y - features.second[j].y),2) + std::pow((features.first[j].x - features.second[j].x),2) );
-        if (direction < median_direction + 0.05 && direction > median_direction - 0.05 && length < (median_lenght * 2) && length > (median_lenght * 0.5) ) {
+        if (directions[j] < median_direction + 0.05 && directions[j] > median_direction - 0.05 && lengths[j] < (median_lenght * 2) && lengths[j] > (median_lenght * 0.5) ) {
             inliers1.push_back(features.first[j]);
             inliers2.push_back(features.second[j]);
         } else {
@@ -217,217 +584,158 @@ void getInliersFromMedianValue (const pair<vector<cv::Point2f>, vector<cv::Point
 }
 
 void getInliersFromHorizontalDirection (const pair<vector<cv::Point2f>, vector<cv::Point2f> >& features, vector<cv::Point2f> &inliers1, vector<cv::Point2f> &inliers2){
-    vector<float> lengths;
-
-    for (unsigned int j = 0; j < features.first.size(); ++j){
-        float length = sqrt( std::pow((features.first[j].y - features.second[j].y),2) + std::pow((features.first[j].x - features.second[j].x),2) );
-        lengths.push_back(length);
-    }
-
-    sort(lengths.begin(),lengths.end());
-    float median_lenght = lengths[(int)(lengths.size()/2)];
-
+    vector<uchar> valid(features.first.size(), 1);
+    getInliersFromHorizontalDirection(features.first, features.second, valid);
 
     for(unsigned int i = 0; i < features.first.size(); ++i)
     {
-        float direction = atan2( (float) (features.first[i].y - features.second[i].y) , (float) (features.first[i].x - features.second[i].x) ) * 180 / M_PI ;
-        float length = sqrt( std::pow((features.first[i].y - features.second[i].y),2) + std::pow((features.first[i].x - features.second[i].x),2) );
-
-        // ignore points with length < 10 pixels.. and take inlier if angle < 10 degree
-        if ((length < (median_lenght * 2) && length > (median_lenght * 0.5) && fabs(direction) < 10 ) || fabs(length) < 10 ) {
-            //std::cout << i << ":  " << direction << "     length: " << length  << "   POS: [" << features.first[i].x << ", " << features.first[i].y << "]" << std::endl;
+        if (valid[i]) {
             inliers1.push_back(features.first[i]);
             inliers2.push_back(features.second[i]);
         } else {
-            //std::cout << i << ":  " << direction << "     length: " << length << "   POS: [" << features.first[i].x << ", " << features.first[i].y << "]" << "   FAILS" << std::endl;
             inliers1.push_back(cv::Point2f(0,0));
             inliers2.push_back(cv::Point2f(0,0));
         }
     }
 }
 
+void getInliersFromHorizontalDirection (const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, vector<uchar>& valid){
+    const unsigned int n = points1.size();
+
+    // squared lengths, the median over the valid rows
+    vector<float> lengths2(n), validLengths2;
+    validLengths2.reserve(n);
+    for (unsigned int i = 0; i < n; ++i){
+        float dx = points1[i].x - points2[i].x;
+        float dy = points1[i].y - points2[i].y;
+        lengths2[i] = dx * dx + dy * dy;
+        if (valid[i]) {
+            validLengths2.push_back(lengths2[i]);
+        }
+    }
 
-void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1La, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points1Ra, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY){
+    if (validLengths2.empty()) {
+        return;
+    }
 
+    std::nth_element(validLengths2.begin(), validLengths2.begin() + validLengths2.size() / 2, validLengths2.end());
+    float median_lenght2 = validLengths2[validLengths2.size() / 2];
 
-    int size = points1L.size();
-    // iterate over all points and delete points, that are not in all frames visible;
-    vector<cv::Point2f>::iterator iter_c1a = points1L.begin();
-    vector<cv::Point2f>::iterator iter_c1b = points1R.begin();
-    vector<cv::Point2f>::iterator iter_c2a = points1La.begin();
-    vector<cv::Point2f>::iterator iter_c2b = points1Ra.begin();
-    vector<cv::Point2f>::iterator iter_c3a = points2L.begin();
-    vector<cv::Point2f>::iterator iter_c3b = points2R.begin();
-    for (unsigned int i = 0; i < size ; ++i ) {
-        if (1 >= points1L[iter_c1a-points1L.begin()].x   &&
-                1 >= points1L[iter_c1a-points1L.begin()].y   ||
-                1 >= points1La[iter_c2a-points1La.begin()].x &&
-                1 >= points1La[iter_c2a-points1La.begin()].y ||
-                1 >= points2L[iter_c3a-points2L.begin()].x &&
-                1 >= points2L[iter_c3a-points2L.begin()].y ||
-                1 >= points1R[iter_c1b-points1R.begin()].x   &&
-                1 >= points1R[iter_c1b-points1R.begin()].y   ||
-                1 >= points1Ra[iter_c2b-points1Ra.begin()].x &&
-                1 >= points1Ra[iter_c2b-points1Ra.begin()].y ||
-                1 >= points2R[iter_c3b-points2R.begin()].x &&
-                1 >= points2R[iter_c3b-points2R.begin()].y ||
-
-                resX <= points1L[iter_c1a-points1L.begin()].x   &&
-                resY <= points1L[iter_c1a-points1L.begin()].y   ||
-                resX <= points1La[iter_c2a-points1La.begin()].x &&
-                resY <= points1La[iter_c2a-points1La.begin()].y ||
-                resX <= points2L[iter_c3a-points2L.begin()].x &&
-                resY <= points2L[iter_c3a-points2L.begin()].y ||
-                resX <= points1R[iter_c1b-points1R.begin()].x   &&
-                resY <= points1R[iter_c1b-points1R.begin()].y   ||
-                resX <= points1Ra[iter_c2b-points1Ra.begin()].x &&
-                resY <= points1Ra[iter_c2b-points1Ra.begin()].y ||
-                resX <= points2R[iter_c3b-points2R.begin()].x &&
-                resY <= points2R[iter_c3b-points2R.begin()].y )
-        {
-            points1L.erase(iter_c1a);
-            points1R.erase(iter_c1b);
-            points1La.erase(iter_c2a);
-            points1Ra.erase(iter_c2b);
-            points2L.erase(iter_c3a);
-            points2R.erase(iter_c3b);
-        } else
-        {
-            ++iter_c1a;
-            ++iter_c1b;
-            ++iter_c2a;
-            ++iter_c2b;
-            ++iter_c3a;
-            ++iter_c3b;
-        }
+    // inlier if the length is between half and twice the median and the direction is within 10 degree of
+    // the x axis (dx > 0 and |dy| < tan(10) dx), or if it is shorter than 10 pixels
+    const float tan10 = 0.176327f;
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        float dx = points1[i].x - points2[i].x;
+        float dy = points1[i].y - points2[i].y;
+        bool inlier = (lengths2[i] < 4 * median_lenght2 && lengths2[i] > 0.25f * median_lenght2 && fabs(dy) < tan10 * dx) || lengths2[i] < 100;
+        valid[i] &= inlier;
     }
 }
 
-void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY){
-    int size = points1L.size();
-    // iterate over all points and delete points, that are not in all frames visible;
-    vector<cv::Point2f>::iterator iter_c1a = points1L.begin();
-    vector<cv::Point2f>::iterator iter_c1b = points1R.begin();
-    vector<cv::Point2f>::iterator iter_c3a = points2L.begin();
-    vector<cv::Point2f>::iterator iter_c3b = points2R.begin();
-    for (unsigned int i = 0; i < size ; ++i ) {
-        if (1 >= points1L[iter_c1a-points1L.begin()].x &&
-            1 >= points1L[iter_c1a-points1L.begin()].y ||
-            1 >= points2L[iter_c3a-points2L.begin()].x &&
-            1 >= points2L[iter_c3a-points2L.begin()].y ||
-            1 >= points1R[iter_c1b-points1R.begin()].x &&
-            1 >= points1R[iter_c1b-points1R.begin()].y ||
-            1 >= points2R[iter_c3b-points2R.begin()].x &&
-            1 >= points2R[iter_c3b-points2R.begin()].y ||
-
-            resX <= points1L[iter_c1a-points1L.begin()].x &&
-            resY <= points1L[iter_c1a-points1L.begin()].y ||
-            resX <= points2L[iter_c3a-points2L.begin()].x &&
-            resY <= points2L[iter_c3a-points2L.begin()].y ||
-            resX <= points1R[iter_c1b-points1R.begin()].x &&
-            resY <= points1R[iter_c1b-points1R.begin()].y ||
-            resX <= points2R[iter_c3b-points2R.begin()].x &&
-            resY <= points2R[iter_c3b-points2R.begin()].y )
-        {
-            points1L.erase(iter_c1a);
-            points1R.erase(iter_c1b);
-            points2L.erase(iter_c3a);
-            points2R.erase(iter_c3b);
-        } else
-        {
-            ++iter_c1a;
-            ++iter_c1b;
-            ++iter_c3a;
-            ++iter_c3b;
-        }
+void getInliersFromEpipolarGeometry (const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, const cv::Mat& F, float threshold, vector<uchar>& valid){
+    const int n = points1.size();
+    if (0 == n) {
+        return;
+    }
+
+    cv::Matx33d F_;
+    F.convertTo(F_, CV_64F);
+
+    vector<float> x1(n), y1(n), x2(n), y2(n), errors(n);
+    for (int i = 0; i < n; ++i) {
+        x1[i] = points1[i].x;
+        y1[i] = points1[i].y;
+        x2[i] = points2[i].x;
+        y2[i] = points2[i].y;
+    }
+    sampsonErrors(F_, &x1[0], &y1[0], &x2[0], &y2[0], n, &errors[0]);
+
+    const float threshold2 = threshold * threshold;
+    for (int i = 0; i < n; ++i) {
+        valid[i] &= (errors[i] <= threshold2);
     }
 }
 
+
+void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1La, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points1Ra, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY){
+    // delete points, that are not in all frames visible
+    vector<uchar> valid(points1L.size(), 1);
+    rejectUnvisiblePoints(points1L, resX, resY, valid);
+    rejectUnvisiblePoints(points1La, resX, resY, valid);
+    rejectUnvisiblePoints(points1R, resX, resY, valid);
+    rejectUnvisiblePoints(points1Ra, resX, resY, valid);
+    rejectUnvisiblePoints(points2L, resX, resY, valid);
+    rejectUnvisiblePoints(points2R, resX, resY, valid);
+
+    compactByMask(points1L, valid);
+    compactByMask(points1La, valid);
+    compactByMask(points1R, valid);
+    compactByMask(points1Ra, valid);
+    compactByMask(points2L, valid);
+    compactByMask(points2R, valid);
+}
+
+void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY){
+    // delete points, that are not in all frames visible
+    vector<uchar> valid(points1L.size(), 1);
+    rejectUnvisiblePoints(points1L, resX, resY, valid);
+    rejectUnvisiblePoints(points1R, resX, resY, valid);
+    rejectUnvisiblePoints(points2L, resX, resY, valid);
+    rejectUnvisiblePoints(points2R, resX, resY, valid);
+
+    compactByMask(points1L, valid);
+    compactByMask(points1R, valid);
+    compactByMask(points2L, valid);
+    compactByMask(points2R, valid);
+}
+
 void deleteZeroLines(vector<cv::Point2f>& points1, vector<cv::Point2f>& points2){
-    int size = points1.size();
-    vector<cv::Point2f>::iterator iter_p1 = points1.begin();
-    vector<cv::Point2f>::iterator iter_p2 = points2.begin();
-    for (unsigned int i = 0; i < size; ++i) {
-        if ((0 == points1[iter_p1-points1.begin()].x && 0 == points1[iter_p1-points1.begin()].y) ||
-                (0 == points2[iter_p2-points2.begin()].x && 0 == points2[iter_p2-points2.begin()].y)){
-            points1.erase(iter_p1);
-            points2.erase(iter_p2);
-        } else {
-            ++iter_p1;
-            ++iter_p2;
-        }
-    }
+    vector<uchar> valid(points1.size(), 1);
+    rejectZeroPoints(points1, valid);
+    rejectZeroPoints(points2, valid);
+
+    compactByMask(points1, valid);
+    compactByMask(points2, valid);
 }
 
 
 void deleteZeroLines(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1R,
                      vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R){
-    int size = points1L.size();
-    vector<cv::Point2f>::iterator iter_p1L = points1L.begin();
-    vector<cv::Point2f>::iterator iter_p1R = points1R.begin();
-    vector<cv::Point2f>::iterator iter_p2L  = points2L.begin();
-    vector<cv::Point2f>::iterator iter_p2R  = points2R.begin();
-    for (unsigned int i = 0; i < size; ++i) {
-        if ((0 == points1L[iter_p1L-points1L.begin()].x && 0 == points1L[iter_p1L-points1L.begin()].y) ||
-                (0 == points1R[iter_p1R-points1R.begin()].x && 0 == points1R[iter_p1R-points1R.begin()].y) ||
-                (0 == points2L[iter_p2L-points2L.begin()].x && 0 == points2L[iter_p2L-points2L.begin()].y) ||
-                (0 == points2R[iter_p2R-points2R.begin()].x && 0 == points2R[iter_p2R-points2R.begin()].y))
-        {
-            points1L.erase(iter_p1L);
-            points1R.erase(iter_p1R);
-            points2L.erase(iter_p2L);
-            points2R.erase(iter_p2R);
-        } else {
-            ++iter_p1L ;
-            ++iter_p1R ;
-            ++iter_p2L  ;
-            ++iter_p2R  ;
-        }
-    }
+    vector<uchar> valid(points1L.size(), 1);
+    rejectZeroPoints(points1L, valid);
+    rejectZeroPoints(points1R, valid);
+    rejectZeroPoints(points2L, valid);
+    rejectZeroPoints(points2R, valid);
+
+    compactByMask(points1L, valid);
+    compactByMask(points1R, valid);
+    compactByMask(points2L, valid);
+    compactByMask(points2R, valid);
 }
 
 void deleteZeroLines(vector<cv::Point2f>& points1La, vector<cv::Point2f>& points1Lb,
                      vector<cv::Point2f>& points1Ra, vector<cv::Point2f>& points1Rb,
                      vector<cv::Point2f>& points2La, vector<cv::Point2f>& points2Lb,
                      vector<cv::Point2f>& points2Ra, vector<cv::Point2f>& points2Rb){
-    int size = points1La.size();
-    vector<cv::Point2f>::iterator iter_p1La = points1La.begin();
-    vector<cv::Point2f>::iterator iter_p1Lb = points1Lb.begin();
-    vector<cv::Point2f>::iterator iter_p1Ra = points1Ra.begin();
-    vector<cv::Point2f>::iterator iter_p1Rb = points1Rb.begin();
-    vector<cv::Point2f>::iterator iter_p2La  = points2La.begin();
-    vector<cv::Point2f>::iterator iter_p2Lb  = points2Lb.begin();
-    vector<cv::Point2f>::iterator iter_p2Ra  = points2Ra.begin();
-    vector<cv::Point2f>::iterator iter_p2Rb  = points2Rb.begin();
-    for (unsigned int i = 0; i < size; ++i) {
-        if (    (0 == points1La[iter_p1La-points1La.begin()].x && 0 == points1La[iter_p1La-points1La.begin()].y) ||
-                (0 == points1Lb[iter_p1Lb-points1Lb.begin()].x && 0 == points1Lb[iter_p1Lb-points1Lb.begin()].y) ||
-                (0 == points1Ra[iter_p1Ra-points1Ra.begin()].x && 0 == points1Ra[iter_p1Ra-points1Ra.begin()].y) ||
-                (0 == points1Rb[iter_p1Rb-points1Rb.begin()].x && 0 == points1Rb[iter_p1Rb-points1Rb.begin()].y) ||
-                (0 == points2La[iter_p2La-points2La.begin()].x && 0 == points2La[iter_p2La-points2La.begin()].y) ||
-                (0 == points2Lb[iter_p2Lb-points2Lb.begin()].x && 0 == points2Lb[iter_p2Lb-points2Lb.begin()].y) ||
-                (0 == points2Ra[iter_p2Ra-points2Ra.begin()].x && 0 == points2Ra[iter_p2Ra-points2Ra.begin()].y) ||
-                (0 == points2Rb[iter_p2Rb-points2Rb.begin()].x && 0 == points2Rb[iter_p2Rb-points2Rb.begin()].y))
-        {
-            points1La.erase(iter_p1La);
-            points1Lb.erase(iter_p1Lb);
-            points1Ra.erase(iter_p1Ra);
-            points1Rb.erase(iter_p1Rb);
-            points2La.erase(iter_p2La);
-            points2Lb.erase(iter_p2Lb);
-            points2Ra.erase(iter_p2Ra);
-            points2Rb.erase(iter_p2Rb);
-        } else {
-            ++iter_p1La;
-            ++iter_p1Lb;
-            ++iter_p1Ra;
-            ++iter_p1Rb;
-            ++iter_p2La;
-            ++iter_p2Lb;
-            ++iter_p2Ra;
-            ++iter_p2Rb;
-        }
-    }
+    vector<uchar> valid(points1La.size(), 1);
+    rejectZeroPoints(points1La, valid);
+    rejectZeroPoints(points1Lb, valid);
+    rejectZeroPoints(points1Ra, valid);
+    rejectZeroPoints(points1Rb, valid);
+    rejectZeroPoints(points2La, valid);
+    rejectZeroPoints(points2Lb, valid);
+    rejectZeroPoints(points2Ra, valid);
+    rejectZeroPoints(points2Rb, valid);
+
+    compactByMask(points1La, valid);
+    compactByMask(points1Lb, valid);
+    compactByMask(points1Ra, valid);
+    compactByMask(points1Rb, valid);
+    compactByMask(points2La, valid);
+    compactByMask(points2Lb, valid);
+    compactByMask(points2Ra, valid);
+    compactByMask(points2Rb, valid);
 }
 
 
@@ -435,36 +743,20 @@ void deleteZeroLines(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1
                      vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R,
                      vector<cv::Point3f>& cloud1, vector<cv::Point3f>& cloud2 )
 {
-    int size = points1L.size();
-    vector<cv::Point2f>::iterator iter_p1L = points1L.begin();
-    vector<cv::Point2f>::iterator iter_p1R = points1R.begin();
-    vector<cv::Point2f>::iterator iter_p2L  = points2L.begin();
-    vector<cv::Point2f>::iterator iter_p2R  = points2R.begin();
-    vector<cv::Point3f>::iterator iter_cloud1  = cloud1.begin();
-    vector<cv::Point3f>::iterator iter_cloud2  = cloud2.begin();
-    for (unsigned int i = 0; i < size; ++i) {
-        if ((0 == points1L[iter_p1L-points1L.begin()].x && 0 == points1L[iter_p1L-points1L.begin()].y) ||
-                (0 == points1R[iter_p1R-points1R.begin()].x && 0 == points1R[iter_p1R-points1R.begin()].y) ||
-                (0 == points2L[iter_p2L-points2L.begin()].x && 0 == points2L[iter_p2L-points2L.begin()].y) ||
-                (0 == points2R[iter_p2R-points2R.begin()].x && 0 == points2R[iter_p2R-points2R.begin()].y) ||
-                (0 == cloud1[iter_cloud1-cloud1.begin()].x  && 0 == cloud1[iter_cloud1-cloud1.begin()].y)  ||
-                (0 == cloud2[iter_cloud2-cloud2.begin()].x  && 0 == cloud2[iter_cloud2-cloud2.begin()].y))
-        {
-            points1L.erase(iter_p1L);
-            points1R.erase(iter_p1R);
-            points2L.erase(iter_p2L);
-            points2R.erase(iter_p2R);
-            cloud1.erase(iter_cloud1);
-            cloud2.erase(iter_cloud2);
-        } else {
-            ++iter_p1L ;
-            ++iter_p1R ;
-            ++iter_p2L  ;
-            ++iter_p2R  ;
-            ++iter_cloud1  ;
-            ++iter_cloud2  ;
-        }
-    }
+    vector<uchar> valid(points1L.size(), 1);
+    rejectZeroPoints(points1L, valid);
+    rejectZeroPoints(points1R, valid);
+    rejectZeroPoints(points2L, valid);
+    rejectZeroPoints(points2R, valid);
+    rejectZeroPoints(cloud1, valid);
+    rejectZeroPoints(cloud2, valid);
+
+    compactByMask(points1L, valid);
+    compactByMask(points1R, valid);
+    compactByMask(points2L, valid);
+    compactByMask(points2R, valid);
+    compactByMask(cloud1, valid);
+    compactByMask(cloud2, valid);
 }
 
 
@@ -10,14 +10,58 @@
 
 #include "Visualisation.h"
 #include "Utility.h"
+#include "ThreadPool.h"
+#include "CorrespondenceTable.h"
 
 using namespace std;
 
+// window size and pyramid levels of the pyramidal lucas kanade tracker (refindFeaturePoints)
+static const cv::Size LK_WINDOW_SIZE(5,5);
+static const int LK_MAX_LEVEL = 10;
+
+// half window size of the zncc window of the rectified stereo matcher (refindFeaturePointsRectified)
+static const int STEREO_WINDOW_RADIUS = 4;
+
 std::vector<cv::Point2f> getStrongFeaturePoints (cv::Mat const& image, int number = 50, float minQualityLevel = .03, float minDistance = 0.1);
+std::vector<cv::Point2f> getStrongFeaturePoints (cv::Mat const& image, cv::Mat const& mask, int number = 50, float minQualityLevel = .03, float minDistance = 0.1);
+// same corners as above, but the image is split into grid tiles which are scored in parallel. every tile
+// takes at most number / tiles features, the tiles are merged in a fixed order (same result for any pool size)
+std::vector<cv::Point2f> getStrongFeaturePoints (ThreadPool& pool, cv::Mat const& image, cv::Mat const& mask, int number = 50, float minQualityLevel = .03, float minDistance = 0.1, cv::Size grid = cv::Size(8, 6));
 void refindFeaturePoints(cv::Mat const& prev_image, cv::Mat const& next_image, vector<cv::Point2f> frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2);
+void refindFeaturePoints(const vector<cv::Mat>& prev_pyramid, const vector<cv::Mat>& next_pyramid, const vector<cv::Point2f>& frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2);
+// same, but points1 / points2 keep every feature and its flow result, found[i] is 0 if it was lost
+void refindFeaturePoints(const vector<cv::Mat>& prev_pyramid, const vector<cv::Mat>& next_pyramid, const vector<cv::Point2f>& frame1_features, vector<cv::Point2f> &points1, vector<cv::Point2f> &points2, vector<uchar>& found);
+// rectified stereo pair: search the match of each left feature only along the same row of the right image,
+// x_R = x_L - d with d in [minDisparity, maxDisparity]. zncc cost (vectorized over the disparities) with
+// parabola subpixel refinement. appends every feature to points_L and its match to points_R, found[i] is 0
+// if there is none (no texture, correlation below minCorrelation or maximum at the border of the range)
+void refindFeaturePointsRectified(const cv::Mat& image_L, const cv::Mat& image_R, const vector<cv::Point2f>& features,
+                                  vector<cv::Point2f>& points_L, vector<cv::Point2f>& points_R, vector<uchar>& found,
+                                  int minDisparity, int maxDisparity, float minCorrelation = 0.8);
+void buildFeaturePyramid(const cv::Mat& image, vector<cv::Mat>& pyramid);
+void refindFeaturePoints(ThreadPool& pool,
+                         const vector<cv::Mat>& pyramid_L1, const vector<cv::Mat>& pyramid_R1,
+                         const cv::Mat& image_L2, const cv::Mat& image_R2,
+                         vector<cv::Mat>& pyramid_L2, vector<cv::Mat>& pyramid_R2,
+                         const vector<cv::Point2f>& features_L1, const vector<cv::Point2f>& features_R1,
+                         vector<cv::Point2f>& points_L1, vector<cv::Point2f>& points_R1,
+                         vector<cv::Point2f>& points_L2, vector<cv::Point2f>& points_R2);
+// L1 / R1 are the features, L2 / R2 the flow results. lost features are invalid, quality is the
+// smaller lk min eigenvalue of the left and right track
+void refindFeaturePoints(ThreadPool& pool,
+                         const vector<cv::Mat>& pyramid_L1, const vector<cv::Mat>& pyramid_R1,
+                         const cv::Mat& image_L2, const cv::Mat& image_R2,
+                         vector<cv::Mat>& pyramid_L2, vector<cv::Mat>& pyramid_R2,
+                         const vector<cv::Point2f>& features_L1, const vector<cv::Point2f>& features_R1,
+                         CorrespondenceTable& correspondences);
 
 void getInliersFromMedianValue (pair<vector<cv::Point2f>, vector<cv::Point2f>> const& features, vector<cv::Point2f> &inliers2, vector<cv::Point2f> &inliers1);
 void getInliersFromHorizontalDirection (const pair<vector<cv::Point2f>, vector<cv::Point2f> >& features, vector<cv::Point2f>& inliers1, vector<cv::Point2f>& inliers2);
+// clears valid[i] of outliers, the median length is taken over the valid rows
+void getInliersFromHorizontalDirection (const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, vector<uchar>& valid);
+// clears valid[i] if points2[i] is farther than threshold (sampson distance, pixel) from the epipolar line
+// F points1[i], e.g. with the calibrated F_LR of the rig (points1 left, points2 right). vectorized, no sort
+void getInliersFromEpipolarGeometry (const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2, const cv::Mat& F, float threshold, vector<uchar>& valid);
 void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1La, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points1Ra, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY);
 void deleteUnvisiblePoints(vector<cv::Point2f>& points1L, vector<cv::Point2f>& points1R, vector<cv::Point2f>& points2L, vector<cv::Point2f>& points2R, int resX, int resY);
 void deleteZeroLines(vector<cv::Point2f> &points1, vector<cv::Point2f> &points2);
@@ -34,7 +78,16 @@ void normalizePoints(const cv::Mat& KLInv, const cv::Mat& KRInv, const vector<cv
 
 void findCorresPoints_LucasKanade(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2, const std::vector<cv::Point2f> &features_L1, const std::vector<cv::Point2f> &features_R1, vector<cv::Point2f> &points_L1, vector<cv::Point2f>& points_R1, vector<cv::Point2f> &points_L2, vector<cv::Point2f> &points_R2);
 
-void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2, vector<cv::Point2f> &points_L1, vector<cv::Point2f>& points_R1, vector<cv::Point2f> &points_L2, vector<cv::Point2f> &points_R2);
+// descriptor matching instead of tracking (e.g. for large motion): orb keypoints of all four images, hamming
+// matches with ratio test and cross check, stereo pairs gated by F_LR (if not empty). appends the
+// correspondences whose four matches are consistent to the point arrays (same rows as the lk tracking).
+// quality (if not 0) gets minus the largest hamming distance of the four matches of each row
+void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2,
+                        vector<cv::Point2f>& points_L1, vector<cv::Point2f>& points_R1, vector<cv::Point2f>& points_L2, vector<cv::Point2f>& points_R2,
+                        const cv::Mat& F_LR = cv::Mat(), float epipolarThreshold = 2, int maxFeatures = 1000, vector<float>* quality = 0);
+// same, fills correspondences (all rows valid, with quality) instead of refindFeaturePoints
+void fastFeatureMatcher(const cv::Mat& frame_L1, const cv::Mat& frame_R1, const cv::Mat& frame_L2, const cv::Mat& frame_R2,
+                        CorrespondenceTable& correspondences, const cv::Mat& F_LR = cv::Mat(), float epipolarThreshold = 2, int maxFeatures = 1000);
 
 
 
@@ -0,0 +1,110 @@
+#include "FrameCache.h"
+#include "Timing.h"
+
+#include <cstring>
+
+static uint64_t pointKey(const cv::Point2f& p){
+    uint32_t x, y;
+    memcpy(&x, &p.x, sizeof(x));
+    memcpy(&y, &p.y, sizeof(y));
+    return ((uint64_t)x << 32) | y;
+}
+
+FrameCache::FrameCache(unsigned int capacity)
+    : _capacity(std::max(2u, capacity))
+{
+}
+
+void FrameCache::setRectified(const cv::Mat& Q){
+    _Q = Q.clone();
+}
+
+bool FrameCache::contains(int frame) const {
+    return _index.find(frame) != _index.end();
+}
+
+FrameProducts& FrameCache::get(int frame){
+    auto it = _index.find(frame);
+    if (it != _index.end()) {
+        // mark as most recently used
+        _frames.splice(_frames.begin(), _frames, it->second);
+        return _frames.front();
+    }
+
+    _frames.push_front(FrameProducts());
+    _frames.front().frame = frame;
+    _index[frame] = _frames.begin();
+
+    while (_frames.size() > _capacity) {
+        _index.erase(_frames.back().frame);
+        _frames.pop_back();
+    }
+
+    return _frames.front();
+}
+
+const vector<cv::Mat>& FrameCache::pyramid_L(int frame, const cv::Mat& image_L){
+    FrameProducts& products = get(frame);
+    if (products.pyramid_L.empty()) {
+        buildFeaturePyramid(image_L, products.pyramid_L);
+    }
+    return products.pyramid_L;
+}
+
+const vector<cv::Mat>& FrameCache::pyramid_R(int frame, const cv::Mat& image_R){
+    FrameProducts& products = get(frame);
+    if (products.pyramid_R.empty()) {
+        buildFeaturePyramid(image_R, products.pyramid_R);
+    }
+    return products.pyramid_R;
+}
+
+void FrameCache::triangulate(int frame, const cv::Mat& PK_0, const cv::Mat& PK_LR,
+                             const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R,
+                             vector<cv::Point3f>& pointcloud)
+{
+    FrameProducts& products = get(frame);
+
+    unordered_map<uint64_t, unsigned int> cached;
+    for (unsigned int i = 0; i < products.stereo_L.size(); ++i) {
+        cached[pointKey(products.stereo_L[i])] = i;
+    }
+
+    // find correspondences that are not triangulated yet
+    vector<int> index(points_L.size(), -1);
+    vector<cv::Point2f> missing_L, missing_R;
+    for (unsigned int i = 0; i < points_L.size(); ++i) {
+        auto it = cached.find(pointKey(points_L[i]));
+        if (it != cached.end() && products.stereo_R[it->second] == points_R[i]) {
+            index[i] = it->second;
+        } else {
+            missing_L.push_back(points_L[i]);
+            missing_R.push_back(points_R[i]);
+        }
+    }
+
+    vector<cv::Point3f> missingCloud;
+    if (!missing_L.empty() && !_Q.empty()) {
+        StageTimer timer("TriangulateStereo");
+        TriangulateStereo(_Q, missing_L, missing_R, missingCloud);
+    } else if (!missing_L.empty()) {
+        StageTimer timer("TriangulatePointsHZ");
+        TriangulatePointsHZ(PK_0, PK_LR, missing_L, missing_R, 0, missingCloud);
+    }
+
+    pointcloud.clear();
+    pointcloud.reserve(points_L.size());
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < points_L.size(); ++i) {
+        if (0 <= index[i]) {
+            pointcloud.push_back(products.cloud[index[i]]);
+        } else {
+            pointcloud.push_back(missingCloud[next++]);
+        }
+    }
+
+    // keep the new points for the next time this frame is used
+    products.stereo_L.insert(products.stereo_L.end(), missing_L.begin(), missing_L.end());
+    products.stereo_R.insert(products.stereo_R.end(), missing_R.begin(), missing_R.end());
+    products.cloud.insert(products.cloud.end(), missingCloud.begin(), missingCloud.end());
+}
@@ -0,0 +1,62 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "FindPoints.h"
+#include "Triangulation.h"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// everything that is derived from one stereo frame and needed again when the
+// frame is used as stereo 2 and afterwards as stereo 1 of the next frame pair.
+struct FrameProducts {
+    int frame;
+
+    // lk pyramids, see buildFeaturePyramid()
+    vector<cv::Mat> pyramid_L;
+    vector<cv::Mat> pyramid_R;
+
+    // stereo correspondences and their triangulated points (same index)
+    vector<cv::Point2f> stereo_L;
+    vector<cv::Point2f> stereo_R;
+    vector<cv::Point3f> cloud;
+};
+
+// frame indexed cache of FrameProducts. the least recently used frame is evicted
+// if more than capacity frames are stored.
+class FrameCache {
+public:
+    FrameCache(unsigned int capacity = 6);
+
+    // returns the products of frame (creates an empty entry if frame is not cached)
+    FrameProducts& get(int frame);
+    bool contains(int frame) const;
+
+    // lk pyramids of frame, built only once
+    const vector<cv::Mat>& pyramid_L(int frame, const cv::Mat& image_L);
+    const vector<cv::Mat>& pyramid_R(int frame, const cv::Mat& image_R);
+
+    // triangulate stereo correspondences from their disparity (TriangulateStereo) instead of
+    // TriangulatePointsHZ. only valid for a rectified rig, see isRectifiedRig()
+    void setRectified(const cv::Mat& Q);
+
+    // triangulate stereo correspondences of frame (TriangulatePointsHZ or TriangulateStereo).
+    // correspondences which are already triangulated for this frame are taken from the cache.
+    void triangulate(int frame, const cv::Mat& PK_0, const cv::Mat& PK_LR,
+                     const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R,
+                     vector<cv::Point3f>& pointcloud);
+
+private:
+    unsigned int _capacity;
+    cv::Mat _Q;                  // empty if the rig is not rectified
+    list<FrameProducts> _frames; // most recently used first
+    unordered_map<int, list<FrameProducts>::iterator> _index;
+};
+
+#endif // FRAMECACHE_H
@@ -0,0 +1,112 @@
+#include "FramePrefetcher.h"
+
+#include <climits>
+
+FramePrefetcher::FramePrefetcher(FrameSource& source, unsigned int queueSize)
+    : _source(source),
+      _queueSize(std::max(1u, queueSize)),
+      _nextFrame(0),
+      _requestedFrame(0),
+      _end(0 > source.size() ? INT_MAX : source.size()),
+      _stop(false)
+{
+    _thread = thread(&FramePrefetcher::run, this);
+}
+
+FramePrefetcher::~FramePrefetcher(){
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _spaceAvailable.notify_all();
+    _thread.join();
+}
+
+int FramePrefetcher::size() const {
+    return _source.size();
+}
+
+void FramePrefetcher::run(){
+    while (true){
+        int frame;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _spaceAvailable.wait(lock, [this]{
+                return _stop || (_queue.size() < _queueSize && std::max(_nextFrame, _requestedFrame) < _end);
+            });
+            if (_stop) {
+                break;
+            }
+
+            // don't decode frames the main loop has already skipped
+            _nextFrame = std::max(_nextFrame, _requestedFrame);
+            frame = _nextFrame++;
+        }
+
+        StereoFrame stereo;
+        stereo.frame = frame;
+        bool loaded;
+        {
+            lock_guard<mutex> lock(_sourceMutex);
+            loaded = _source.read(frame, stereo.image_L, stereo.image_R);
+        }
+
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (loaded) {
+                _queue.push_back(stereo);
+            } else {
+                // end of a source of unknown size
+                _end = std::min(_end, frame);
+            }
+        }
+        _frameLoaded.notify_all();
+    }
+}
+
+bool FramePrefetcher::getFrame(int frame, cv::Mat& image_L, cv::Mat& image_R){
+    if (0 > frame) {
+        return false;
+    }
+
+    {
+        unique_lock<mutex> lock(_mutex);
+        if (_end <= frame) {
+            return false;
+        }
+
+        bool backwards = frame < _requestedFrame;
+        _requestedFrame = std::max(_requestedFrame, frame);
+
+        // drop all frames older than the requested one
+        while (!_queue.empty() && _queue.front().frame < frame) {
+            _queue.pop_front();
+        }
+        _spaceAvailable.notify_all();
+
+        // the loader never skips frames >= requested frame, so wait for it.
+        // frames older than a previous request may be dropped already: read them again
+        bool alreadyDropped = backwards && (_queue.empty() || _queue.front().frame != frame);
+        if (!alreadyDropped) {
+            while (_queue.empty() || _queue.front().frame < frame) {
+                if (!_queue.empty()) {
+                    // loader was still busy with an older frame
+                    _queue.pop_front();
+                    _spaceAvailable.notify_all();
+                    continue;
+                }
+                if (_end <= frame) {
+                    return false;
+                }
+                _frameLoaded.wait(lock);
+            }
+
+            image_L = _queue.front().image_L;
+            image_R = _queue.front().image_R;
+            return true;
+        }
+    }
+
+    lock_guard<mutex> lock(_sourceMutex);
+    return _source.read(frame, image_L, image_R);
+}
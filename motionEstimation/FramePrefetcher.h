@@ -0,0 +1,58 @@
+#ifndef FRAMEPREFETCHER_H
+#define FRAMEPREFETCHER_H
+
+#include "FrameSource.h"
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// decodes the next stereo pairs of a frame source in a background thread, so that
+// loading runs while the current pair is processed in the main loop.
+// frames have to be requested with a non decreasing index (frame1 <= frame2),
+// older frames are dropped from the queue.
+class FramePrefetcher {
+public:
+    // source has to outlive the prefetcher
+    FramePrefetcher(FrameSource& source, unsigned int queueSize = 4);
+    ~FramePrefetcher();
+
+    // blocks until the stereo pair of frame is decoded. returns false if frame is behind the end
+    // of the source. images are empty if one of the images can't be loaded (same as cv::imread)
+    bool getFrame(int frame, cv::Mat& image_L, cv::Mat& image_R);
+
+    // -1 if unknown, see FrameSource::size()
+    int size() const;
+
+private:
+    struct StereoFrame {
+        int frame;
+        cv::Mat image_L;
+        cv::Mat image_R;
+    };
+
+    void run();
+
+    FrameSource& _source;
+    unsigned int _queueSize;
+
+    deque<StereoFrame> _queue;
+    int _nextFrame;
+    int _requestedFrame;
+    int _end;               // first frame behind the end of the source
+    bool _stop;
+
+    mutex _mutex;
+    mutex _sourceMutex;     // sources are not thread safe
+    condition_variable _frameLoaded;
+    condition_variable _spaceAvailable;
+    thread _thread;
+};
+
+#endif // FRAMEPREFETCHER_H
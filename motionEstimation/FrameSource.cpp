@@ -0,0 +1,276 @@
+#include "FrameSource.h"
+#include "Utility.h"
+
+#include <fstream>
+#include <cstdlib>
+
+DirectoryFrameSource::DirectoryFrameSource(const string& dataPath)
+    : _dataPath(dataPath)
+{
+    getFiles(dataPath + "left/", _filenames_left);
+    getFiles(dataPath + "right/", _filenames_right);
+}
+
+int DirectoryFrameSource::size() const {
+    return std::min(_filenames_left.size(), _filenames_right.size());
+}
+
+bool DirectoryFrameSource::read(int frame, cv::Mat& image_L, cv::Mat& image_R){
+    if (0 > frame || size() <= frame) {
+        return false;
+    }
+
+    image_L = cv::imread(_dataPath + "left/" + _filenames_left[frame],0);
+    image_R = cv::imread(_dataPath + "right/"+ _filenames_right[frame],0);
+    return true;
+}
+
+SequenceFrameSource::SequenceFrameSource(const string& file)
+    : _sequence(file)
+{
+}
+
+int SequenceFrameSource::size() const {
+    return _sequence.size();
+}
+
+bool SequenceFrameSource::read(int frame, cv::Mat& image_L, cv::Mat& image_R){
+    return _sequence.getFrame(frame, image_L, image_R);
+}
+
+SequentialFrameSource::SequentialFrameSource()
+    : _nextFrame(0)
+{
+}
+
+bool SequentialFrameSource::read(int frame, cv::Mat& image_L, cv::Mat& image_R){
+    image_L.release();
+    image_R.release();
+    if (0 > frame) {
+        return false;
+    }
+
+    // can't seek back
+    if (frame < _nextFrame) {
+        if (frame == _nextFrame - 1) {
+            image_L = _last_L;
+            image_R = _last_R;
+        }
+        return true;
+    }
+
+    while (_nextFrame <= frame) {
+        if (!readNext(_last_L, _last_R)) {
+            _last_L.release();
+            _last_R.release();
+            return false;
+        }
+        ++_nextFrame;
+    }
+
+    image_L = _last_L;
+    image_R = _last_R;
+    return true;
+}
+
+VideoFrameSource::VideoFrameSource(const string& file)
+    : _size(-1)
+{
+    // a number is the index of a camera device
+    char* end = 0;
+    long device = strtol(file.c_str(), &end, 10);
+    if (!file.empty() && '\0' == *end) {
+        _capture.open(device);
+    } else {
+        _capture.open(file);
+        int frames = _capture.get(CV_CAP_PROP_FRAME_COUNT);
+        if (0 < frames) {
+            _size = frames;
+        }
+    }
+
+    if (!_capture.isOpened()) {
+        std::cout << "Error: could not open video " << file << std::endl;
+    }
+}
+
+int VideoFrameSource::size() const {
+    return _size;
+}
+
+bool VideoFrameSource::readNext(cv::Mat& image_L, cv::Mat& image_R){
+    cv::Mat image;
+    if (!_capture.read(image) || image.empty()) {
+        return false;
+    }
+
+    cv::Mat gray;
+    if (1 < image.channels()) {
+        cv::cvtColor(image, gray, CV_BGR2GRAY);
+    } else {
+        gray = image;
+    }
+
+    // left half | right half. a new image per frame, the capture reuses its buffer
+    int width = gray.cols / 2;
+    image_L = gray(cv::Rect(0, 0, width, gray.rows)).clone();
+    image_R = gray(cv::Rect(width, 0, width, gray.rows)).clone();
+    return true;
+}
+
+PipeFrameSource::PipeFrameSource(int width, int height, FILE* stream)
+    : _width(width), _height(height), _stream(stream)
+{
+}
+
+bool PipeFrameSource::readNext(cv::Mat& image_L, cv::Mat& image_R){
+    if (0 >= _width || 0 >= _height) {
+        return false;
+    }
+
+    size_t imageSize = (size_t)_width * _height;
+    image_L.create(_height, _width, CV_8UC1);
+    image_R.create(_height, _width, CV_8UC1);
+    if (imageSize != fread(image_L.data, 1, imageSize, _stream) ||
+            imageSize != fread(image_R.data, 1, imageSize, _stream)) {
+        image_L.release();
+        image_R.release();
+        return false;
+    }
+
+    return true;
+}
+
+ReplayFrameSource::ReplayFrameSource(FrameSource& source, const vector<double>& timestamps, double fps, unsigned int bufferSize)
+    : _source(source),
+      _timestamps(timestamps),
+      _fps(0 < fps ? fps : 25),
+      _bufferSize(std::max(1u, bufferSize)),
+      _arrived(0),
+      _dropped(0),
+      _latencyCount(0),
+      _latencySum(0),
+      _finished(false),
+      _stop(false)
+{
+    _thread = thread(&ReplayFrameSource::run, this);
+}
+
+ReplayFrameSource::~ReplayFrameSource(){
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _stopRequested.notify_all();
+    _thread.join();
+
+    std::cout << "replay: " << _arrived << " frames, " << _dropped << " dropped, mean latency "
+              << meanLatency() * 1000 << " ms" << std::endl;
+}
+
+int ReplayFrameSource::size() const {
+    return _source.size();
+}
+
+int ReplayFrameSource::dropped() const {
+    lock_guard<mutex> lock(_mutex);
+    return _dropped;
+}
+
+double ReplayFrameSource::meanLatency() const {
+    lock_guard<mutex> lock(_mutex);
+    return 0 < _latencyCount ? _latencySum / _latencyCount : 0;
+}
+
+double ReplayFrameSource::timestamp(int frame) const {
+    if (frame < (int)_timestamps.size()) {
+        return _timestamps[frame] - _timestamps[0];
+    }
+    return frame / _fps;
+}
+
+void ReplayFrameSource::run(){
+    Clock::time_point start = Clock::now();
+
+    for (int frame = 0; ; ++frame) {
+        // decode ahead of time, the frame "arrives" at its timestamp
+        StereoFrame stereo;
+        stereo.frame = frame;
+        stereo.read = false;
+        bool loaded = _source.read(frame, stereo.image_L, stereo.image_R);
+
+        unique_lock<mutex> lock(_mutex);
+        if (!loaded) {
+            _finished = true;
+            break;
+        }
+
+        Clock::time_point arrival = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(timestamp(frame)));
+        if (_stopRequested.wait_until(lock, arrival, [this]{ return _stop; })) {
+            break;
+        }
+
+        stereo.arrival = Clock::now();
+        if (_buffer.size() == _bufferSize) {
+            _dropped += !_buffer.front().read;
+            _buffer.pop_front();
+        }
+        _buffer.push_back(stereo);
+        ++_arrived;
+
+        lock.unlock();
+        _frameArrived.notify_all();
+    }
+
+    _frameArrived.notify_all();
+}
+
+bool ReplayFrameSource::read(int frame, cv::Mat& image_L, cv::Mat& image_R){
+    image_L.release();
+    image_R.release();
+    if (0 > frame) {
+        return false;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    _frameArrived.wait(lock, [this, frame]{ return _finished || _stop || frame < _arrived; });
+    if (frame >= _arrived) {
+        return false;
+    }
+
+    // older frames are never read again, the ones that were never read are dropped
+    while (!_buffer.empty() && _buffer.front().frame < frame) {
+        _dropped += !_buffer.front().read;
+        _buffer.pop_front();
+    }
+
+    // dropped, the pipeline was too slow
+    if (_buffer.empty() || _buffer.front().frame != frame) {
+        return true;
+    }
+
+    // stereo 2 is read again as stereo 1 of the next frame pair, count its latency once
+    StereoFrame& stereo = _buffer.front();
+    image_L = stereo.image_L;
+    image_R = stereo.image_R;
+    if (!stereo.read) {
+        _latencySum += chrono::duration<double>(Clock::now() - stereo.arrival).count();
+        ++_latencyCount;
+        stereo.read = true;
+    }
+    return true;
+}
+
+bool loadTimestamps(const string& file, vector<double>& timestamps){
+    timestamps.clear();
+    std::ifstream stream(file.c_str());
+    if (!stream) {
+        return false;
+    }
+
+    double timestamp;
+    while (stream >> timestamp) {
+        timestamps.push_back(timestamp);
+    }
+    return !timestamps.empty();
+}
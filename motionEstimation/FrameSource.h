@@ -0,0 +1,168 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include "StereoSequence.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// input of stereo pairs (8 bit grayscale). sources are read through the FramePrefetcher, except a
+// ReplayFrameSource which bypasses it and is read directly by the main loop.
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    // number of frames, -1 if unknown (live or streamed input ends when read() returns false)
+    virtual int size() const = 0;
+
+    // load frame into image_L and image_R. returns false if frame is behind the end of the input.
+    // images are empty if the frame can't be read (same as cv::imread).
+    virtual bool read(int frame, cv::Mat& image_L, cv::Mat& image_R) = 0;
+};
+
+// images of dataPath + "left/" and "right/"
+class DirectoryFrameSource : public FrameSource {
+public:
+    DirectoryFrameSource(const string& dataPath);
+
+    int size() const;
+    bool read(int frame, cv::Mat& image_L, cv::Mat& image_R);
+
+private:
+    string _dataPath;
+    vector<string> _filenames_left;
+    vector<string> _filenames_right;
+};
+
+// packed stereo sequence, see StereoSequence.h
+class SequenceFrameSource : public FrameSource {
+public:
+    SequenceFrameSource(const string& file);
+
+    bool isOpen() const { return _sequence.isOpen(); }
+
+    int size() const;
+    bool read(int frame, cv::Mat& image_L, cv::Mat& image_R);
+
+private:
+    StereoSequence _sequence;
+};
+
+// base of the sources which can only be read front to back. frames between two reads
+// are decoded and discarded, the last frame can be read again, older frames are empty.
+class SequentialFrameSource : public FrameSource {
+public:
+    SequentialFrameSource();
+
+    bool read(int frame, cv::Mat& image_L, cv::Mat& image_R);
+
+protected:
+    // decode the next stereo pair. returns false at the end of the input
+    virtual bool readNext(cv::Mat& image_L, cv::Mat& image_R) = 0;
+
+private:
+    int _nextFrame;
+    cv::Mat _last_L;
+    cv::Mat _last_R;
+};
+
+// side by side video (left | right in one image) of a file or a camera device ("0", "1", ...)
+class VideoFrameSource : public SequentialFrameSource {
+public:
+    VideoFrameSource(const string& file);
+
+    bool isOpen() const { return _capture.isOpened(); }
+
+    int size() const;
+
+protected:
+    bool readNext(cv::Mat& image_L, cv::Mat& image_R);
+
+private:
+    cv::VideoCapture _capture;
+    int _size;
+};
+
+// raw 8 bit stereo pairs from a pipe: per frame width*height bytes of the left image
+// followed by width*height bytes of the right image
+class PipeFrameSource : public SequentialFrameSource {
+public:
+    PipeFrameSource(int width, int height, FILE* stream = stdin);
+
+    int size() const { return -1; }
+
+protected:
+    bool readNext(cv::Mat& image_L, cv::Mat& image_R);
+
+private:
+    int _width;
+    int _height;
+    FILE* _stream;
+};
+
+// replays source at the original frame rate like a live camera: a background thread releases
+// the frames at their timestamps into a ring buffer of bufferSize frames. if the pipeline
+// is too slow the oldest frames are overwritten, dropped frames are read as empty images.
+class ReplayFrameSource : public FrameSource {
+public:
+    // timestamps in seconds per frame, frames without timestamp arrive at frame / fps
+    ReplayFrameSource(FrameSource& source, const vector<double>& timestamps, double fps = 25, unsigned int bufferSize = 4);
+    // prints the number of dropped frames and the mean latency from arrival to read. read it directly
+    // from the main loop (not through a FramePrefetcher), else the prefetcher queue hides both
+    ~ReplayFrameSource();
+
+    int size() const;
+    bool read(int frame, cv::Mat& image_L, cv::Mat& image_R);
+
+    int dropped() const;
+    // mean seconds between the arrival of a frame and its first read
+    double meanLatency() const;
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    struct StereoFrame {
+        int frame;
+        Clock::time_point arrival;
+        bool read;
+        cv::Mat image_L;
+        cv::Mat image_R;
+    };
+
+    void run();
+    double timestamp(int frame) const;
+
+    FrameSource& _source;
+    vector<double> _timestamps;
+    double _fps;
+    unsigned int _bufferSize;
+
+    deque<StereoFrame> _buffer;
+    int _arrived;           // number of frames released so far
+    int _dropped;
+    int _latencyCount;
+    double _latencySum;
+    bool _finished;
+    bool _stop;
+
+    mutable mutex _mutex;
+    condition_variable _frameArrived;
+    condition_variable _stopRequested;
+    thread _thread;
+};
+
+// one timestamp in seconds per line
+bool loadTimestamps(const string& file, vector<double>& timestamps);
+
+#endif // FRAMESOURCE_H
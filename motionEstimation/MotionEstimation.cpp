@@ -1,4 +1,5 @@
 #include "MotionEstimation.h"
+#include "Ransac.h"
 
 
 // find pose estimation using orientation mapping of pointcloud with ransac
@@ -13,46 +14,36 @@ bool motionEstimationPnP (const std::vector<cv::Point2f>& imgPoints,
         return false;
     }
 
-    cv::Mat rvec;
-    cv::Rodrigues(R, rvec);
-
-    std::vector<int> inliers;
-
     double minVal,maxVal;
     cv::minMaxIdx(imgPoints,&minVal,&maxVal);
 
-    std::vector<float > distCoeffVec; //just use empty vector.. images are allready undistorted..
-
-    /*
-     * solvePnPRansac(InputArray objectPoints, InputArray imagePoints, InputArray cameraMatrix, InputArray distCoeffs,
-     *                OutputArray rvec, OutputArray tvec, bool useExtrinsicGuess=false, int iterationsCount=100,
-     *                float reprojectionError=8.0, int minInliersCount=100, OutputArray inliers=noArray(), int flags=ITERATIVE )
-     */
-    //cv::solvePnPRansac(pointCloud_1LR, imgPoints, K, distCoeffVec, rvec, T);
-    cv::solvePnPRansac(pointCloud_1LR, imgPoints, K, distCoeffVec, rvec, T, true, 1000, 0.006 * maxVal, 0.25 * (float)(imgPoints.size()), inliers, CV_EPNP);
-    rvec.convertTo(rvec, CV_32F);
-    T.convertTo(T, CV_32F);
-
-    // calculate reprojection error and define inliers
-    std::vector<cv::Point2f> projected3D;
-    cv::projectPoints(pointCloud_1LR, rvec, T, K, distCoeffVec, projected3D);
-    if(inliers.size() == 0){
-
-        for(unsigned int i=0;i<projected3D.size();i++) {
-            //std::cout << "repro error " << norm(projected3D[i]-imgPoints[i])  << std::endl;
-            if(norm(projected3D[i]-imgPoints[i]) < 10.0)
-                inliers.push_back(i);
-        }
+    // R / T are the extrinsic guess (e.g. from the essential matrix)
+    bool useGuess = (!R.empty() && !T.empty());
+    cv::Matx33d K_, R_ = cv::Matx33d::eye();
+    cv::Vec3d T_(0, 0, 0);
+    K.convertTo(K_, CV_64F);
+    if (useGuess) {
+        R.convertTo(R_, CV_64F);
+        T.convertTo(T_, CV_64F);
     }
 
+    std::vector<uchar> inliers;
+    bool found = findPoseRansac(pointCloud_1LR, imgPoints, K_,
+                                inliers, R_, T_, useGuess,
+                                0.006 * maxVal,     // reprojection error (pixel)
+                                .99,                // confidence probability
+                                1000);              // max iterations
+    if (!found) {
+        return false;
+    }
 
-    if(inliers.size() < (float)(imgPoints.size())/5.0) {
+    if(cv::countNonZero(inliers) < (float)(imgPoints.size())/5.0) {
         //std::cout << "NO MOVEMENT: not enough inliers to consider a good pose ("<<inliers.size()<<"/"<<imgPoints.size()<<")" << std::endl;
         return false;
     }
 
-    cv::Rodrigues(rvec, R);
-    R.convertTo(R, CV_32F);
+    cv::Mat(T_).convertTo(T, CV_32F);
+    cv::Mat(R_).convertTo(R, CV_32F);
     if(!CheckCoherentRotation(R)) {
         //std::cout <<  "NO MOVEMENT: rotation is incoherent..." << std::endl;
         return false;
@@ -66,15 +57,29 @@ bool motionEstimationEssentialMat (const std::vector<cv::Point2f>& points_1,
                                    const std::vector<cv::Point2f>& points_2,
                                    const cv::Mat& F,
                                    const cv::Mat& K,
-                                   cv::Mat& T, cv::Mat& R)
+                                   cv::Mat& T, cv::Mat& R,
+                                   std::vector<cv::Point3f>* pointCloud)
 {
     // calculate essential mat
     cv::Mat E = K.t() * F * K; //according to HZ (9.12)
 
+    return motionEstimationFromEssentialMat(points_1, points_2, E, K, T, R, pointCloud);
+}
+
+bool motionEstimationFromEssentialMat (const std::vector<cv::Point2f>& points_1,
+                                       const std::vector<cv::Point2f>& points_2,
+                                       const cv::Mat& E,
+                                       const cv::Mat& K,
+                                       cv::Mat& T, cv::Mat& R,
+                                       std::vector<cv::Point3f>* pointCloud)
+{
+    // getRightProjectionMat may flip the sign of E
+    cv::Mat E_ = E.clone();
+
     // decompose right solution for R and T values and saved it to P1. get point cloud of triangulated points
     cv::Mat P;
-    std::vector<cv::Point3f> pointCloud;
-    bool goodPFound = getRightProjectionMat(E, P, K, points_1, points_2, pointCloud);
+    std::vector<cv::Point3f> cloud;
+    bool goodPFound = getRightProjectionMat(E_, P, K, points_1, points_2, cloud);
 
     if (!goodPFound) {
         cout << "NO MOVEMENT: no perspective Mat Found" << endl;
@@ -89,11 +94,58 @@ bool motionEstimationEssentialMat (const std::vector<cv::Point2f>& points_1,
     T = T_temp;
     R = R_temp;
 
+    // up to scale, in the coordinate system of the first camera
+    if (pointCloud) {
+        pointCloud->swap(cloud);
+    }
+
     return true;
 }
 
 
 
+bool motionEstimationStereoRig (const std::vector<cv::Point3f>& pointCloud_1,
+                                const std::vector<cv::Point3f>& pointCloud_2,
+                                const std::vector<cv::Point2f>& points_L2,
+                                const std::vector<cv::Point2f>& points_R2,
+                                const cv::Mat& K_L, const cv::Mat& K_R,
+                                const cv::Mat& R_LR, const cv::Mat& T_LR,
+                                cv::Mat& T, cv::Mat& R,
+                                const std::vector<float>* quality,
+                                std::vector<uchar>* inliers)
+{
+    cv::Matx33d K_L_, K_R_, R_LR_;
+    cv::Vec3d T_LR_;
+    K_L.convertTo(K_L_, CV_64F);
+    K_R.convertTo(K_R_, CV_64F);
+    R_LR.convertTo(R_LR_, CV_64F);
+    T_LR.convertTo(T_LR_, CV_64F);
+
+    std::vector<uchar> mask;
+    cv::Matx33d R_;
+    cv::Vec3d T_;
+    bool found = findRigMotionRansac(pointCloud_1, pointCloud_2, points_L2, points_R2, K_L_, K_R_, R_LR_, T_LR_,
+                                     mask, R_, T_,
+                                     2.,                // rms reprojection error of both cameras (pixel)
+                                     .99,               // confidence probability
+                                     500,               // max iterations
+                                     quality);          // PROSAC order
+    if (!found) {
+        return false;
+    }
+
+    cv::Mat(T_).convertTo(T, CV_32F);
+    cv::Mat(R_).convertTo(R, CV_32F);
+    if (inliers) {
+        inliers->swap(mask);
+    }
+
+    if(!CheckCoherentRotation(R)) {
+        return false;
+    }
+    return true;
+}
+
 bool motionEstimationStereoCloudMatching (const std::vector<cv::Point3f>& pointCloud_1,
                                           const std::vector<cv::Point3f>& pointCloud_2,
                                           cv::Mat& T, cv::Mat& R)
@@ -29,7 +29,29 @@ bool motionEstimationEssentialMat (const std::vector<cv::Point2f>& points_1,
                                    const std::vector<cv::Point2f>& points_2,
                                    const cv::Mat& F,
                                    const cv::Mat& K,
-                                   cv::Mat& T, cv::Mat& R);
+                                   cv::Mat& T, cv::Mat& R,
+                                   std::vector<cv::Point3f>* pointCloud = 0);
+
+// E from getEssentialMatrix (calibrated points), the rest as motionEstimationEssentialMat
+bool motionEstimationFromEssentialMat (const std::vector<cv::Point2f>& points_1,
+                                       const std::vector<cv::Point2f>& points_2,
+                                       const cv::Mat& E,
+                                       const cv::Mat& K,
+                                       cv::Mat& T, cv::Mat& R,
+                                       std::vector<cv::Point3f>* pointCloud = 0);
+
+// one motion of the stereo rig from the stereo clouds of both frames (findRigMotionRansac): T, R of the
+// left camera as in motionEstimationEssentialMat, but with the metric scale of the clouds.
+// quality orders the RANSAC samples, inliers (optional) is the RANSAC mask
+bool motionEstimationStereoRig (const std::vector<cv::Point3f>& pointCloud_1,
+                                const std::vector<cv::Point3f>& pointCloud_2,
+                                const std::vector<cv::Point2f>& points_L2,
+                                const std::vector<cv::Point2f>& points_R2,
+                                const cv::Mat& K_L, const cv::Mat& K_R,
+                                const cv::Mat& R_LR, const cv::Mat& T_LR,
+                                cv::Mat& T, cv::Mat& R,
+                                const std::vector<float>* quality = 0,
+                                std::vector<uchar>* inliers = 0);
 
 bool motionEstimationPnP (const std::vector<cv::Point2f>& imgPoints,
                           const std::vector<cv::Point3f>& pointCloud_1LR,
@@ -3,25 +3,51 @@ CONFIG += console
 CONFIG -= app_bundle
 CONFIG -= qt
 
-QMAKE_CXXFLAGS += -std=c++11 -fPIC -g -fexpensive-optimizations -D_GNULINUX -O3
+# explicit simd target instead of -march=native, so the binary runs on any cpu with avx (sandy bridge,
+# bulldozer and newer). the lane kernels use avx, then sse2, the hamming distance ssse3.
+# older cpus: qmake SIMD_FLAGS=-msse2
+isEmpty(SIMD_FLAGS): SIMD_FLAGS = -msse4.2 -mavx
+QMAKE_CXXFLAGS += -std=c++11 -fPIC -g -fexpensive-optimizations -D_GNULINUX -O3 $$SIMD_FLAGS -pthread
 SOURCES += \
     MotionEstimation.cpp \
     FindCameraMatrices.cpp \
+    Ransac.cpp \
     FindPoints.cpp \
+    CorrespondenceTable.cpp \
     Triangulation.cpp \
     Visualisation.cpp \
     PointCloudVis.cpp \
     main.cpp \
-    Utility.cpp
+    Utility.cpp \
+    FramePrefetcher.cpp \
+    FeatureTracks.cpp \
+    FrameCache.cpp \
+    ThreadPool.cpp \
+    DisparityMap.cpp \
+    StereoSequence.cpp \
+    FrameSource.cpp \
+    Timing.cpp
 
 HEADERS += \
     FindCameraMatrices.h \
+    Ransac.h \
+    SimdLanes.h \
     FindPoints.h \
+    CorrespondenceTable.h \
     Triangulation.h \
     Visualisation.h \
     PointCloudVis.h \
     MotionEstimation.h \
-    Utility.h
+    Utility.h \
+    FramePrefetcher.h \
+    FeatureTracks.h \
+    FrameCache.h \
+    ThreadPool.h \
+    DisparityMap.h \
+    StereoSequence.h \
+    FrameSource.h \
+    Timing.h \
+    RigidTransform.h
 
 unix:!macx: LIBS += -lopencv_core \
                     -lopencv_imgproc \
@@ -38,7 +64,9 @@ unix:!macx: LIBS += -lopencv_core \
                     -lvtkFiltering \
                     -lvtkRendering \
                     -lvtkGraphics \
-                    -lboost_system
+                    -lboost_system \
+                    -lpthread \
+                    -llz4
 
 INCLUDEPATH += /usr/include/pcl-1.7 /usr/include/eigen3 /usr/include/vtk-5.8
 
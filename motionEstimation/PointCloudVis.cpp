@@ -5,7 +5,8 @@
 #include <pcl/visualization/point_picking_event.h>
 
 
-pcl::visualization::PCLVisualizer viewer("MotionEstimation Viewer");
+// created in initVisualisation(), so no render window is opened in headless mode
+pcl::visualization::PCLVisualizer* viewer = 0;
 pcl::visualization::PointPickingEvent mouseEvent();
 
 
@@ -26,7 +27,11 @@ void initVisualisation(){
 
     cout << "INIT VISUALISATION " << endl;
 
-    viewer.addCoordinateSystem(300,0,0,0);
+    if (!viewer) {
+        viewer = new pcl::visualization::PCLVisualizer("MotionEstimation Viewer");
+    }
+
+    viewer->addCoordinateSystem(300,0,0,0);
 
     // add ground plane
     vtkSmartPointer<vtkPlaneSource> planeSource = vtkSmartPointer<vtkPlaneSource>::New ();
@@ -46,7 +51,7 @@ void initVisualisation(){
     planeActor->GetProperty()->SetOpacity(0.4);
 
     //do not hack!!!!
-    viewer.addActorToRenderer(planeActor);
+    viewer->addActorToRenderer(planeActor);
 
     //viewer.addSphere(pcl::PointXYZ(1000,2500,5000), 50, 255, 0 ,0, "sphere");
 }
@@ -125,7 +130,7 @@ void AddLineToVisualizer(const std::vector<cv::Point3f>& pointCloud_1, const std
     for (unsigned int i = 0; i < pointCloud_1.size(); ++i){
         pcl::PointXYZ point1(pointCloud_1[i].x, pointCloud_1[i].y, pointCloud_1[i].z);
         pcl::PointXYZ point2(pointCloud_2[i].x, pointCloud_2[i].y, pointCloud_2[i].z);
-        viewer.addLine(point1, point2, color[0], color[1], color[2], name+std::to_string(i));
+        viewer->addLine(point1, point2, color[0], color[1], color[2], name+std::to_string(i));
     }
 }
 
@@ -143,16 +148,16 @@ void pp_callback(const pcl::visualization::PointPickingEvent& event, void* viewe
 void RunVisualization(int index) {
     // draw pointclouds
     for (auto p : point_clouds) {
-        viewer.addPointCloud(p.second, p.first);
+        viewer->addPointCloud(p.second, p.first);
     }
 
     point_clouds.clear();
 
     if (index == 0){
-        viewer.registerPointPickingCallback(pp_callback, (void*)&viewer);
+        viewer->registerPointPickingCallback(pp_callback, (void*)viewer);
     }
 
-    viewer.spinOnce();
+    viewer->spinOnce();
 }
 
 void addCameraToVisualizer(const Eigen::Matrix3f& R, const Eigen::Vector3f& _t, float r, float g, float b, float s, const std::string& name) {
@@ -167,14 +172,14 @@ void addCameraToVisualizer(const Eigen::Matrix3f& R, const Eigen::Vector3f& _t,
     Eigen::Vector3f vforward = R.col(2).normalized() * s;
 
     Eigen::Quaternionf RotQ(R);
-    viewer.addCube(_t, RotQ, 50,50,50,name_);
+    viewer->addCube(_t, RotQ, 50,50,50,name_);
 
 
     pcl::PointXYZ point1(_t(0), _t(1), _t(2));
     Eigen::Vector3f temp = _t+(10*vforward);
     pcl::PointXYZ point2(temp(0), temp(1), temp(2));
 
-    viewer.addLine(point1, point2, r,g,b, line_name);
+    viewer->addLine(point1, point2, r,g,b, line_name);
 }
 void addCameraToVisualizer(const float R[9], const float t[3], float r, float g, float b) {
     addCameraToVisualizer(Eigen::Matrix3f(R).transpose(),Eigen::Vector3f(t),r,g,b);
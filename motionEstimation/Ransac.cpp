@@ -0,0 +1,1112 @@
+#include "Ransac.h"
+#include "SimdLanes.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+namespace {
+
+// squared sampson distance: (x2^T F x1)^2 / (|(F x1)_12|^2 + |(F^T x2)_12|^2)
+struct SampsonKernel {
+    const cv::Matx33d& F;
+    const float *x1, *y1, *x2, *y2;
+    float* errors;
+
+    template <class V>
+    void run(int i) const {
+        const V u1 = V::load(x1 + i), v1 = V::load(y1 + i);
+        const V u2 = V::load(x2 + i), v2 = V::load(y2 + i);
+
+        // epipolar lines F x1 and F^T x2
+        const V a = V(F(0,0)) * u1 + V(F(0,1)) * v1 + V(F(0,2));
+        const V b = V(F(1,0)) * u1 + V(F(1,1)) * v1 + V(F(1,2));
+        const V c = V(F(2,0)) * u1 + V(F(2,1)) * v1 + V(F(2,2));
+        const V d = V(F(0,0)) * u2 + V(F(1,0)) * v2 + V(F(2,0));
+        const V e = V(F(0,1)) * u2 + V(F(1,1)) * v2 + V(F(2,1));
+
+        const V r = u2 * a + v2 * b + c;
+        (r * r / (a * a + b * b + d * d + e * e)).store(errors + i);
+    }
+};
+
+// centroid to the origin and mean distance sqrt(2) (hartley)
+cv::Matx33d getNormalization(const vector<cv::Point2f>& points){
+    double cx = 0, cy = 0;
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        cx += points[i].x;
+        cy += points[i].y;
+    }
+    cx /= points.size();
+    cy /= points.size();
+
+    double distance = 0;
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        distance += std::sqrt((points[i].x - cx) * (points[i].x - cx) + (points[i].y - cy) * (points[i].y - cy));
+    }
+    distance /= points.size();
+
+    double s = (0 < distance) ? std::sqrt(2.) / distance : 1.;
+    return cv::Matx33d(s, 0, -s * cx,
+                       0, s, -s * cy,
+                       0, 0, 1);
+}
+
+// row of A f = 0 for x2^T F x1 = 0 (f is F row major)
+inline void epipolarRow(double x1, double y1, double x2, double y2, double a[9]){
+    a[0] = x2 * x1; a[1] = x2 * y1; a[2] = x2;
+    a[3] = y2 * x1; a[4] = y2 * y1; a[5] = y2;
+    a[6] = x1;      a[7] = y1;      a[8] = 1;
+}
+
+// basis of the null space of the rows x 9 matrix A (gauss jordan, A is overwritten), 9 - rows vectors.
+// false if the rank of A is below rows
+bool nullSpace(double A[][9], int rows, double basis[][9]){
+    int pivotColumn[9];
+    bool isPivot[9] = {false, false, false, false, false, false, false, false, false};
+
+    int row = 0;
+    for (int col = 0; col < 9 && row < rows; ++col) {
+        int best = row;
+        for (int r = row + 1; r < rows; ++r) {
+            if (std::fabs(A[r][col]) > std::fabs(A[best][col])) {
+                best = r;
+            }
+        }
+        if (1e-10 > std::fabs(A[best][col])) {
+            continue;
+        }
+
+        if (best != row) {
+            for (int c = 0; c < 9; ++c) {
+                std::swap(A[best][c], A[row][c]);
+            }
+        }
+
+        double inverse = 1. / A[row][col];
+        for (int c = col; c < 9; ++c) {
+            A[row][c] *= inverse;
+        }
+        for (int r = 0; r < rows; ++r) {
+            if (r != row && 0 != A[r][col]) {
+                double factor = A[r][col];
+                for (int c = col; c < 9; ++c) {
+                    A[r][c] -= factor * A[row][c];
+                }
+            }
+        }
+
+        pivotColumn[row] = col;
+        isPivot[col] = true;
+        ++row;
+    }
+
+    if (rows > row) {
+        return false;
+    }
+
+    for (int c = 0, k = 0; c < 9; ++c) {
+        if (isPivot[c]) {
+            continue;
+        }
+        for (int i = 0; i < 9; ++i) {
+            basis[k][i] = 0;
+        }
+        basis[k][c] = 1;
+        for (int r = 0; r < rows; ++r) {
+            basis[k][pivotColumn[r]] = -A[r][c];
+        }
+        ++k;
+    }
+    return true;
+}
+
+inline double det3(const double f[9]){
+    return f[0] * (f[4] * f[8] - f[5] * f[7])
+         - f[1] * (f[3] * f[8] - f[5] * f[6])
+         + f[2] * (f[3] * f[7] - f[4] * f[6]);
+}
+
+// real roots of c[3] x^3 + c[2] x^2 + c[1] x + c[0] = 0
+int solveCubic(const double c[4], double roots[3]){
+    double scale = std::max(std::fabs(c[0]), std::max(std::fabs(c[1]), std::fabs(c[2])));
+    if (1e-12 * scale >= std::fabs(c[3])) {
+        // quadratic or linear
+        if (1e-12 * std::max(std::fabs(c[0]), std::fabs(c[1])) >= std::fabs(c[2])) {
+            if (0 == c[1]) {
+                return 0;
+            }
+            roots[0] = -c[0] / c[1];
+            return 1;
+        }
+        double discriminant = c[1] * c[1] - 4 * c[2] * c[0];
+        if (0 > discriminant) {
+            return 0;
+        }
+        double q = -0.5 * (c[1] + (0 <= c[1] ? 1 : -1) * std::sqrt(discriminant));
+        roots[0] = q / c[2];
+        if (0 == q) {
+            return 1;
+        }
+        roots[1] = c[0] / q;
+        return 2;
+    }
+
+    double a = c[2] / c[3], b = c[1] / c[3], d = c[0] / c[3];
+
+    // depressed cubic t^3 + p t + q with x = t - a/3
+    double p = b - a * a / 3;
+    double q = 2 * a * a * a / 27 - a * b / 3 + d;
+    double discriminant = q * q / 4 + p * p * p / 27;
+
+    if (0 < discriminant) {
+        double s = std::sqrt(discriminant);
+        roots[0] = std::cbrt(-q / 2 + s) + std::cbrt(-q / 2 - s) - a / 3;
+        return 1;
+    }
+
+    if (0 == p) {
+        roots[0] = -a / 3;
+        return 1;
+    }
+
+    double r = 2 * std::sqrt(-p / 3);
+    double phi = std::acos(std::max(-1., std::min(1., 3 * q / (p * r)))) / 3;
+    for (int k = 0; k < 3; ++k) {
+        roots[k] = r * std::cos(phi - 2 * M_PI * k / 3) - a / 3;
+    }
+    return 3;
+}
+
+// 7 point algorithm on normalized coordinates: F = alpha f1 + (1 - alpha) f2 with det(F) = 0.
+// returns the number of models (0 .. 3)
+int sevenPoint(const double* u1, const double* v1, const double* u2, const double* v2, const int sample[7], cv::Matx33d models[3]){
+    double A[7][9];
+    for (int i = 0; i < 7; ++i) {
+        epipolarRow(u1[sample[i]], v1[sample[i]], u2[sample[i]], v2[sample[i]], A[i]);
+    }
+
+    double basis[2][9];
+    if (!nullSpace(A, 7, basis)) {
+        return 0;
+    }
+    const double* f1 = basis[0];
+    const double* f2 = basis[1];
+
+    // det(alpha f1 + (1 - alpha) f2) is cubic in alpha, fitted through alpha = 0, 1, -1, 2
+    double f_m1[9], f_2[9];
+    for (int i = 0; i < 9; ++i) {
+        f_m1[i] = 2 * f2[i] - f1[i];
+        f_2[i] = 2 * f1[i] - f2[i];
+    }
+    double d_0 = det3(f2), d_1 = det3(f1), d_m1 = det3(f_m1), d_2 = det3(f_2);
+
+    double c[4];
+    c[0] = d_0;
+    c[2] = (d_1 + d_m1) / 2 - d_0;
+    double c13 = (d_1 - d_m1) / 2;
+    c[3] = (d_2 - c[0] - 4 * c[2] - 2 * c13) / 6;
+    c[1] = c13 - c[3];
+
+    double alpha[3];
+    int numberOfRoots = solveCubic(c, alpha);
+    for (int k = 0; k < numberOfRoots; ++k) {
+        for (int i = 0; i < 9; ++i) {
+            models[k].val[i] = alpha[k] * f1[i] + (1 - alpha[k]) * f2[i];
+        }
+    }
+    return numberOfRoots;
+}
+
+// 8 point algorithm on the normalized coordinates of rows with rank 2 enforced
+bool eightPoint(const double* u1, const double* v1, const double* u2, const double* v2, const vector<int>& rows, cv::Matx33d& F){
+    if (8 > rows.size()) {
+        return false;
+    }
+
+    cv::Matx<double,9,9> AtA = cv::Matx<double,9,9>::zeros();
+    double a[9];
+    for (unsigned int k = 0; k < rows.size(); ++k) {
+        epipolarRow(u1[rows[k]], v1[rows[k]], u2[rows[k]], v2[rows[k]], a);
+        for (int i = 0; i < 9; ++i) {
+            for (int j = i; j < 9; ++j) {
+                AtA(i,j) += a[i] * a[j];
+            }
+        }
+    }
+    for (int i = 0; i < 9; ++i) {
+        for (int j = 0; j < i; ++j) {
+            AtA(i,j) = AtA(j,i);
+        }
+    }
+
+    // eigenvector of the smallest eigenvalue (eigenvalues are sorted descending)
+    cv::Matx<double,9,1> values;
+    cv::Matx<double,9,9> vectors;
+    if (!cv::eigen(AtA, values, vectors)) {
+        return false;
+    }
+    for (int i = 0; i < 9; ++i) {
+        F.val[i] = vectors(8, i);
+    }
+
+    cv::Matx31d w;
+    cv::Matx33d u, vt;
+    cv::SVD::compute(F, w, u, vt);
+    F = u * cv::Matx33d::diag(cv::Matx31d(w(0), w(1), 0)) * vt;
+    return true;
+}
+
+// squared reprojection error of (x, y, z) through P against the image point (u, v)
+template <class V>
+inline V squaredReprojection(const cv::Matx34d& P, const V& x, const V& y, const V& z, const V& u, const V& v)
+{
+    const V w = V(P(2,0)) * x + V(P(2,1)) * y + V(P(2,2)) * z + V(P(2,3));
+    const V du = (V(P(0,0)) * x + V(P(0,1)) * y + V(P(0,2)) * z + V(P(0,3))) / w - u;
+    const V dv = (V(P(1,0)) * x + V(P(1,1)) * y + V(P(1,2)) * z + V(P(1,3))) / w - v;
+    return du * du + dv * dv;
+}
+
+struct ReprojectionKernel {
+    const cv::Matx34d& P;
+    const float *X, *Y, *Z, *x, *y;
+    float* errors;
+
+    template <class V>
+    void run(int i) const {
+        squaredReprojection(P, V::load(X + i), V::load(Y + i), V::load(Z + i), V::load(x + i), V::load(y + i)).store(errors + i);
+    }
+};
+
+// squared reprojection error of X moved by the rig motion, summed over the left (PL = K_L [R|t]) and
+// the right camera (PR = K_R [R_LR R | R_LR t + T_LR])
+struct RigReprojectionKernel {
+    const cv::Matx34d& PL;
+    const cv::Matx34d& PR;
+    const float *X, *Y, *Z, *xL, *yL, *xR, *yR;
+    float* errors;
+
+    template <class V>
+    void run(int i) const {
+        const V x = V::load(X + i), y = V::load(Y + i), z = V::load(Z + i);
+        (squaredReprojection(PL, x, y, z, V::load(xL + i), V::load(yL + i)) +
+         squaredReprojection(PR, x, y, z, V::load(xR + i), V::load(yR + i))).store(errors + i);
+    }
+};
+
+void reprojectionErrors(const cv::Matx34d& P, const float* X, const float* Y, const float* Z,
+                        const float* x, const float* y, int n, float* errors)
+{
+    ReprojectionKernel kernel = {P, X, Y, Z, x, y, errors};
+    forEachLane(n, kernel);
+}
+
+void rigReprojectionErrors(const cv::Matx34d& PL, const cv::Matx34d& PR, const float* X, const float* Y, const float* Z,
+                           const float* xL, const float* yL, const float* xR, const float* yR, int n, float* errors)
+{
+    RigReprojectionKernel kernel = {PL, PR, X, Y, Z, xL, yL, xR, yR, errors};
+    forEachLane(n, kernel);
+}
+
+// [R|t] with X2 = R X1 + t from the cross covariance A = sum w (X2 - mean2)(X1 - mean1)^T (kabsch)
+bool kabsch(const cv::Matx33d& A, const cv::Vec3d& mean1, const cv::Vec3d& mean2, cv::Matx34d& motion){
+    cv::Matx31d s;
+    cv::Matx33d u, vt;
+    cv::SVD::compute(A, s, u, vt);
+    // collinear points
+    if (1e-9 * s(0) >= s(1)) {
+        return false;
+    }
+
+    double sign = (0 > det3(u.val) * det3(vt.val)) ? -1 : 1;
+    cv::Matx33d R = u * cv::Matx33d::diag(cv::Matx31d(1, 1, sign)) * vt;
+    cv::Vec3d t = mean2 - R * mean1;
+    motion = cv::Matx34d(R(0,0), R(0,1), R(0,2), t[0],
+                         R(1,0), R(1,1), R(1,2), t[1],
+                         R(2,0), R(2,1), R(2,2), t[2]);
+    return true;
+}
+
+// weighted least squares rigid motion X2 = R X1 + t of the rows (kabsch), motion = [R|t].
+// the weight 1 / z^2 accounts for the stereo error growing with the distance
+bool rigidMotion(const float* X1, const float* Y1, const float* Z1, const float* X2, const float* Y2, const float* Z2,
+                 const int* rows, int count, cv::Matx34d& motion)
+{
+    double weightSum = 0;
+    cv::Vec3d mean1(0, 0, 0), mean2(0, 0, 0);
+    for (int k = 0; k < count; ++k) {
+        int i = rows[k];
+        double w = 1. / std::max(1e-6, double(Z1[i]) * Z1[i]);
+        weightSum += w;
+        mean1 += w * cv::Vec3d(X1[i], Y1[i], Z1[i]);
+        mean2 += w * cv::Vec3d(X2[i], Y2[i], Z2[i]);
+    }
+    if (3 > count || 0 >= weightSum) {
+        return false;
+    }
+    mean1 *= 1. / weightSum;
+    mean2 *= 1. / weightSum;
+
+    cv::Matx33d A = cv::Matx33d::zeros();
+    for (int k = 0; k < count; ++k) {
+        int i = rows[k];
+        double w = 1. / std::max(1e-6, double(Z1[i]) * Z1[i]);
+        cv::Vec3d d1 = cv::Vec3d(X1[i], Y1[i], Z1[i]) - mean1;
+        cv::Vec3d d2 = cv::Vec3d(X2[i], Y2[i], Z2[i]) - mean2;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                A(r,c) += w * d2[r] * d1[c];
+            }
+        }
+    }
+
+    return kabsch(A, mean1, mean2, motion);
+}
+
+// rotation matrix of the rotation vector w (rodrigues)
+cv::Matx33d rotationFromVector(const cv::Vec3d& w){
+    cv::Matx33d W(0, -w[2], w[1],
+                  w[2], 0, -w[0],
+                  -w[1], w[0], 0);
+    double theta = cv::norm(w);
+    if (1e-12 > theta) {
+        return cv::Matx33d::eye() + W;
+    }
+    return cv::Matx33d::eye() + W * (std::sin(theta) / theta) + W * W * ((1 - std::cos(theta)) / (theta * theta));
+}
+
+// gauss newton on the reprojection error of the rows in the left and the right image of frame 2 (left
+// image only if xR is 0). motion = [R|t] is updated to [exp(w) R | exp(w) t + d]
+void refineMotion(const float* X1, const float* Y1, const float* Z1,
+                  const float* xL, const float* yL, const float* xR, const float* yR,
+                  const int* rows, int count,
+                  const cv::Matx33d& K_L, const cv::Matx33d& K_R, const cv::Matx33d& R_LR, const cv::Vec3d& T_LR,
+                  cv::Matx34d& motion, int iterations = 5)
+{
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        cv::Matx33d R(motion(0,0), motion(0,1), motion(0,2),
+                      motion(1,0), motion(1,1), motion(1,2),
+                      motion(2,0), motion(2,1), motion(2,2));
+        cv::Vec3d t(motion(0,3), motion(1,3), motion(2,3));
+
+        cv::Matx<double,6,6> JtJ = cv::Matx<double,6,6>::zeros();
+        cv::Matx<double,6,1> Jtr = cv::Matx<double,6,1>::zeros();
+        for (int k = 0; k < count; ++k) {
+            int i = rows[k];
+            cv::Vec3d X = R * cv::Vec3d(X1[i], Y1[i], Z1[i]) + t;
+
+            // d X / d (w, d) = [-[X]x | I]
+            cv::Matx<double,3,6> dX(0, X[2], -X[1], 1, 0, 0,
+                                    -X[2], 0, X[0], 0, 1, 0,
+                                    X[1], -X[0], 0, 0, 0, 1);
+
+            for (int camera = 0; camera < (xR ? 2 : 1); ++camera) {
+                const cv::Matx33d& K = camera ? K_R : K_L;
+                cv::Vec3d p = camera ? K * (R_LR * X + T_LR) : K * X;
+                if (0 >= p[2]) {
+                    continue;
+                }
+                double u = p[0] / p[2], v = p[1] / p[2];
+                double ru = u - (camera ? xR[i] : xL[i]);
+                double rv = v - (camera ? yR[i] : yL[i]);
+
+                // d (u, v) / d X
+                cv::Matx33d KM = camera ? K * R_LR : K;
+                cv::Matx<double,2,3> duv(KM(0,0) - u * KM(2,0), KM(0,1) - u * KM(2,1), KM(0,2) - u * KM(2,2),
+                                         KM(1,0) - v * KM(2,0), KM(1,1) - v * KM(2,1), KM(1,2) - v * KM(2,2));
+                cv::Matx<double,2,6> J = duv * dX * (1. / p[2]);
+
+                for (int r = 0; r < 6; ++r) {
+                    Jtr(r) += J(0,r) * ru + J(1,r) * rv;
+                    for (int c = r; c < 6; ++c) {
+                        JtJ(r,c) += J(0,r) * J(0,c) + J(1,r) * J(1,c);
+                    }
+                }
+            }
+        }
+        for (int r = 0; r < 6; ++r) {
+            for (int c = 0; c < r; ++c) {
+                JtJ(r,c) = JtJ(c,r);
+            }
+        }
+
+        cv::Matx<double,6,1> step = JtJ.solve(-Jtr, cv::DECOMP_CHOLESKY);
+        cv::Matx33d dR = rotationFromVector(cv::Vec3d(step(0), step(1), step(2)));
+        R = dR * R;
+        t = dR * t + cv::Vec3d(step(3), step(4), step(5));
+        motion = cv::Matx34d(R(0,0), R(0,1), R(0,2), t[0],
+                             R(1,0), R(1,1), R(1,2), t[1],
+                             R(2,0), R(2,1), R(2,2), t[2]);
+    }
+}
+
+// polynomial in x, y, z of degree <= 3, the coefficient of x^a y^b z^c is c[16 a + 4 b + c]
+struct Cubic3 {
+    double c[64];
+    Cubic3() { std::fill(c, c + 64, 0.); }
+};
+
+Cubic3 operator+(const Cubic3& p, const Cubic3& q){
+    Cubic3 r;
+    for (int i = 0; i < 64; ++i) {
+        r.c[i] = p.c[i] + q.c[i];
+    }
+    return r;
+}
+
+Cubic3 operator-(const Cubic3& p, const Cubic3& q){
+    Cubic3 r;
+    for (int i = 0; i < 64; ++i) {
+        r.c[i] = p.c[i] - q.c[i];
+    }
+    return r;
+}
+
+// the product must not exceed degree 3 (true for all terms of the essential matrix constraints)
+Cubic3 operator*(const Cubic3& p, const Cubic3& q){
+    Cubic3 r;
+    for (int i = 0; i < 64; ++i) {
+        if (0 == p.c[i]) {
+            continue;
+        }
+        for (int j = 0; j < 64; ++j) {
+            if (0 != q.c[j]) {
+                r.c[i + j] += p.c[i] * q.c[j];
+            }
+        }
+    }
+    return r;
+}
+
+// monomials of the 10 x 20 constraint matrix (nister 2004):
+// x^3, y^3, x^2y, xy^2, x^2z, x^2, y^2z, y^2, xyz, xy | xz^2, xz, x, yz^2, yz, y, z^3, z^2, z, 1
+const int FIVE_POINT_MONOMIALS[20] = {48, 12, 36, 24, 33, 32, 9, 8, 21, 20, 18, 17, 16, 6, 5, 4, 3, 2, 1, 0};
+
+// c = a * b, coefficients ascending
+inline void polyMul(const double* a, int na, const double* b, int nb, double* c){
+    std::fill(c, c + na + nb - 1, 0.);
+    for (int i = 0; i < na; ++i) {
+        for (int j = 0; j < nb; ++j) {
+            c[i + j] += a[i] * b[j];
+        }
+    }
+}
+
+inline double polyVal(const double* c, int n, double z){
+    double value = 0;
+    for (int i = n - 1; i >= 0; --i) {
+        value = value * z + c[i];
+    }
+    return value;
+}
+
+// 5 point algorithm (nister 2004) on calibrated coordinates: E = x X + y Y + z Z + W from the null space
+// of the epipolar constraints, det(E) = 0 and 2 E E^T E - tr(E E^T) E = 0 reduce to a polynomial of
+// degree 10 in z. returns the number of models (0 .. 10)
+int fivePoint(const double* u1, const double* v1, const double* u2, const double* v2, const int sample[5], cv::Matx33d models[10]){
+    double A[5][9];
+    for (int i = 0; i < 5; ++i) {
+        epipolarRow(u1[sample[i]], v1[sample[i]], u2[sample[i]], v2[sample[i]], A[i]);
+    }
+
+    double basis[4][9];
+    if (!nullSpace(A, 5, basis)) {
+        return 0;
+    }
+
+    Cubic3 E[9];
+    for (int i = 0; i < 9; ++i) {
+        E[i].c[16] = basis[0][i];
+        E[i].c[4] = basis[1][i];
+        E[i].c[1] = basis[2][i];
+        E[i].c[0] = basis[3][i];
+    }
+
+    Cubic3 EEt[9];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = i; j < 3; ++j) {
+            EEt[3 * i + j] = E[3 * i] * E[3 * j] + E[3 * i + 1] * E[3 * j + 1] + E[3 * i + 2] * E[3 * j + 2];
+            EEt[3 * j + i] = EEt[3 * i + j];
+        }
+    }
+    Cubic3 halfTrace = EEt[0] + EEt[4] + EEt[8];
+    for (int i = 0; i < 64; ++i) {
+        halfTrace.c[i] *= 0.5;
+    }
+
+    Cubic3 constraints[10];
+    constraints[0] = E[0] * (E[4] * E[8] - E[5] * E[7])
+                   - E[1] * (E[3] * E[8] - E[5] * E[6])
+                   + E[2] * (E[3] * E[7] - E[4] * E[6]);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            constraints[1 + 3 * i + j] = EEt[3 * i] * E[j] + EEt[3 * i + 1] * E[3 + j] + EEt[3 * i + 2] * E[6 + j]
+                                       - halfTrace * E[3 * i + j];
+        }
+    }
+
+    // gauss jordan on the first 10 monomials
+    double M[10][20];
+    for (int r = 0; r < 10; ++r) {
+        for (int c = 0; c < 20; ++c) {
+            M[r][c] = constraints[r].c[FIVE_POINT_MONOMIALS[c]];
+        }
+    }
+    for (int col = 0; col < 10; ++col) {
+        int best = col;
+        for (int r = col + 1; r < 10; ++r) {
+            if (std::fabs(M[r][col]) > std::fabs(M[best][col])) {
+                best = r;
+            }
+        }
+        if (1e-12 > std::fabs(M[best][col])) {
+            return 0;
+        }
+        if (best != col) {
+            for (int c = 0; c < 20; ++c) {
+                std::swap(M[best][c], M[col][c]);
+            }
+        }
+
+        double inverse = 1. / M[col][col];
+        for (int c = col; c < 20; ++c) {
+            M[col][c] *= inverse;
+        }
+        for (int r = 0; r < 10; ++r) {
+            if (r != col && 0 != M[r][col]) {
+                double factor = M[r][col];
+                for (int c = col; c < 20; ++c) {
+                    M[r][c] -= factor * M[col][c];
+                }
+            }
+        }
+    }
+
+    // <k> = <e> - z <f>, <l> = <g> - z <h>, <m> = <i> - z <j> are linear in x, y, 1:
+    // B(z) [x y 1]^T = 0 with polynomials in z of degree 3, 3 and 4 in the columns
+    double Bx[3][4], By[3][4], B1[3][5];
+    for (int k = 0; k < 3; ++k) {
+        const double* r = &M[4 + 2 * k][10];
+        const double* s = &M[5 + 2 * k][10];
+        Bx[k][0] = r[2]; Bx[k][1] = r[1] - s[2]; Bx[k][2] = r[0] - s[1]; Bx[k][3] = -s[0];
+        By[k][0] = r[5]; By[k][1] = r[4] - s[5]; By[k][2] = r[3] - s[4]; By[k][3] = -s[3];
+        B1[k][0] = r[9]; B1[k][1] = r[8] - s[9]; B1[k][2] = r[7] - s[8]; B1[k][3] = r[6] - s[7]; B1[k][4] = -s[6];
+    }
+
+    // det(B(z)), cofactor expansion along the first column
+    double c[11] = {0};
+    double p7[8], q7[8], p10[11];
+    const int cofactor[3][2] = {{1, 2}, {2, 0}, {0, 1}};
+    for (int k = 0; k < 3; ++k) {
+        int i = cofactor[k][0], j = cofactor[k][1];
+        // Bx[k] (By[i] B1[j] - By[j] B1[i])
+        polyMul(By[i], 4, B1[j], 5, p7);
+        polyMul(By[j], 4, B1[i], 5, q7);
+        for (int d = 0; d < 8; ++d) {
+            p7[d] -= q7[d];
+        }
+        polyMul(Bx[k], 4, p7, 8, p10);
+        for (int d = 0; d < 11; ++d) {
+            c[d] += p10[d];
+        }
+    }
+
+    cv::Mat coefficients(1, 11, CV_64F, c);
+    cv::Mat roots;
+    cv::solvePoly(coefficients, roots);
+
+    double derivative[10];
+    for (int d = 0; d < 10; ++d) {
+        derivative[d] = (d + 1) * c[d + 1];
+    }
+
+    int numberOfModels = 0;
+    for (unsigned int k = 0; k < roots.total(); ++k) {
+        const cv::Vec2d& root = roots.at<cv::Vec2d>(k);
+        if (1e-4 * std::max(1., std::fabs(root[0])) < std::fabs(root[1])) {
+            continue;
+        }
+
+        // polish the real part
+        double z = root[0];
+        for (int step = 0; step < 2; ++step) {
+            double slope = polyVal(derivative, 10, z);
+            if (0 != slope) {
+                z -= polyVal(c, 11, z) / slope;
+            }
+        }
+
+        // [x y 1] is the null vector of B(z), the largest cross product of two rows
+        cv::Vec3d rows[3];
+        for (int i = 0; i < 3; ++i) {
+            rows[i] = cv::Vec3d(polyVal(Bx[i], 4, z), polyVal(By[i], 4, z), polyVal(B1[i], 5, z));
+        }
+        cv::Vec3d v = rows[0].cross(rows[1]);
+        cv::Vec3d w = rows[1].cross(rows[2]);
+        if (cv::norm(w) > cv::norm(v)) {
+            v = w;
+        }
+        w = rows[2].cross(rows[0]);
+        if (cv::norm(w) > cv::norm(v)) {
+            v = w;
+        }
+        if (1e-12 * cv::norm(v) >= std::fabs(v[2])) {
+            continue;
+        }
+
+        double x = v[0] / v[2], y = v[1] / v[2];
+        for (int i = 0; i < 9; ++i) {
+            models[numberOfModels].val[i] = x * basis[0][i] + y * basis[1][i] + z * basis[2][i] + basis[3][i];
+        }
+        ++numberOfModels;
+    }
+    return numberOfModels;
+}
+
+// p3p of grunert (haralick et al. 1994) on the unit bearing vectors j of the sample: the distances s_i of
+// the points along j_i follow from a quartic, the pose from X_i <-> s_i j_i (kabsch).
+// returns the number of models (0 .. 4)
+int p3p(const double* jx, const double* jy, const double* jz, const float* X, const float* Y, const float* Z,
+        const int sample[3], cv::Matx34d models[4])
+{
+    cv::Vec3d j[3], P[3];
+    for (int k = 0; k < 3; ++k) {
+        j[k] = cv::Vec3d(jx[sample[k]], jy[sample[k]], jz[sample[k]]);
+        P[k] = cv::Vec3d(X[sample[k]], Y[sample[k]], Z[sample[k]]);
+    }
+
+    // sides opposite to the angles alpha (j1, j2), beta (j0, j2) and gamma (j0, j1)
+    double a2 = (P[1] - P[2]).dot(P[1] - P[2]);
+    double b2 = (P[0] - P[2]).dot(P[0] - P[2]);
+    double c2 = (P[0] - P[1]).dot(P[0] - P[1]);
+    if (DBL_EPSILON >= b2) {
+        return 0;
+    }
+    double cosAlpha = j[1].dot(j[2]), cosBeta = j[0].dot(j[2]), cosGamma = j[0].dot(j[1]);
+
+    double p = (a2 - c2) / b2, q = (a2 + c2) / b2;
+    double c[5];
+    c[4] = (p - 1) * (p - 1) - 4 * c2 / b2 * cosAlpha * cosAlpha;
+    c[3] = 4 * (p * (1 - p) * cosBeta - (1 - q) * cosAlpha * cosGamma + 2 * c2 / b2 * cosAlpha * cosAlpha * cosBeta);
+    c[2] = 2 * (p * p - 1 + 2 * p * p * cosBeta * cosBeta + 2 * (b2 - c2) / b2 * cosAlpha * cosAlpha
+                - 4 * q * cosAlpha * cosBeta * cosGamma + 2 * (b2 - a2) / b2 * cosGamma * cosGamma);
+    c[1] = 4 * (-p * (1 + p) * cosBeta + 2 * a2 / b2 * cosGamma * cosGamma * cosBeta - (1 - q) * cosAlpha * cosGamma);
+    c[0] = (1 + p) * (1 + p) - 4 * a2 / b2 * cosGamma * cosGamma;
+
+    cv::Mat coefficients(1, 5, CV_64F, c);
+    cv::Mat roots;
+    cv::solvePoly(coefficients, roots);
+
+    double derivative[4] = {c[1], 2 * c[2], 3 * c[3], 4 * c[4]};
+    cv::Vec3d mean1 = (P[0] + P[1] + P[2]) * (1. / 3);
+
+    int numberOfModels = 0;
+    for (unsigned int k = 0; k < roots.total(); ++k) {
+        const cv::Vec2d& root = roots.at<cv::Vec2d>(k);
+        if (1e-4 * std::max(1., std::fabs(root[0])) < std::fabs(root[1])) {
+            continue;
+        }
+
+        // polish the real part, v = s_2 / s_0
+        double v = root[0];
+        for (int step = 0; step < 2; ++step) {
+            double slope = polyVal(derivative, 4, v);
+            if (0 != slope) {
+                v -= polyVal(c, 5, v) / slope;
+            }
+        }
+
+        // u = s_1 / s_0
+        double denominator = 2 * (cosGamma - v * cosAlpha);
+        if (DBL_EPSILON >= std::fabs(denominator)) {
+            continue;
+        }
+        double u = ((p - 1) * v * v - 2 * p * cosBeta * v + 1 + p) / denominator;
+        double s0 = b2 / (1 + v * v - 2 * v * cosBeta);
+        if (0 >= s0 || 0 >= u || 0 >= v) {
+            continue;
+        }
+        s0 = std::sqrt(s0);
+
+        cv::Vec3d Q[3] = {s0 * j[0], u * s0 * j[1], v * s0 * j[2]};
+        cv::Vec3d mean2 = (Q[0] + Q[1] + Q[2]) * (1. / 3);
+        cv::Matx33d A = cv::Matx33d::zeros();
+        for (int i = 0; i < 3; ++i) {
+            A += (Q[i] - mean2) * (P[i] - mean1).t();
+        }
+        if (kabsch(A, mean1, mean2, models[numberOfModels])) {
+            ++numberOfModels;
+        }
+    }
+    return numberOfModels;
+}
+
+int countInliers(const vector<float>& errors, double threshold2){
+    int count = 0;
+    for (unsigned int i = 0; i < errors.size(); ++i) {
+        count += (errors[i] <= threshold2);
+    }
+    return count;
+}
+
+// iterations needed to draw one outlier free sample of m points with the inlier ratio inliers / n
+int neededIterations(int inliers, int n, int m, double confidence, int maxIterations){
+    double p = std::pow(double(inliers) / n, m);
+    p = std::max(DBL_EPSILON, std::min(1 - DBL_EPSILON, p));
+    double needed = std::log(1 - confidence) / std::log(1 - p);
+    return std::min<double>(maxIterations, std::max(0., std::ceil(needed)));
+}
+
+// ransac over minimal samples of m points (at most 7): solve(sample, models) returns the number of
+// models of one sample (at most 10), refit(rows, model) improves model on rows (least squares) and
+// score(model, errors) the squared error of all n points. a guess is scored before the first sample.
+// see findFundamentalMatRansac
+template <class Model, class Solve, class Refit, class Score>
+bool runRansac(int m, int n, Solve solve, Refit refit, Score score,
+               double threshold2, double confidence, int maxIterations, const vector<float>* quality,
+               vector<uchar>& mask, Model& bestModel, const Model* guess = 0)
+{
+    // PROSAC (chum and matas 2005): the sampled subset grows from the best points to all points
+    const bool prosac = (quality && (int)quality->size() == n);
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    if (prosac) {
+        const vector<float>& q = *quality;
+        std::stable_sort(order.begin(), order.end(), [&q](int a, int b){ return q[a] > q[b]; });
+    }
+
+    int subset = prosac ? m : n;
+    double T_n = 200000;
+    for (int i = 0; i < m; ++i) {
+        T_n *= double(m - i) / (n - i);
+    }
+    double T_n_prime = 1;
+
+    vector<float> errors(n);
+    int bestInliers = 0;
+    int iterations = maxIterations;
+    if (guess) {
+        score(*guess, &errors[0]);
+        int inliers = countInliers(errors, threshold2);
+        if (m <= inliers) {
+            bestInliers = inliers;
+            bestModel = *guess;
+            iterations = neededIterations(inliers, n, m, confidence, maxIterations);
+        }
+    }
+
+    cv::RNG rng(0x2545F491);
+    for (int t = 1; t <= iterations; ++t) {
+        bool includeLast = false;
+        if (prosac) {
+            while (t > T_n_prime && subset < n) {
+                double T_next = T_n * (subset + 1) / (subset + 1 - m);
+                T_n_prime += std::ceil(T_next - T_n);
+                T_n = T_next;
+                ++subset;
+            }
+            includeLast = (t <= T_n_prime);
+        }
+
+        // m distinct points of the subset, with the last point of the subset in PROSAC
+        int sample[7];
+        int count = 0;
+        if (includeLast) {
+            sample[count++] = order[subset - 1];
+        }
+        int range = includeLast ? subset - 1 : subset;
+        while (count < m) {
+            int candidate = order[rng.uniform(0, range)];
+            bool used = false;
+            for (int j = 0; j < count; ++j) {
+                used |= (sample[j] == candidate);
+            }
+            if (!used) {
+                sample[count++] = candidate;
+            }
+        }
+
+        Model models[10];
+        int numberOfModels = solve(sample, models);
+        for (int k = 0; k < numberOfModels; ++k) {
+            score(models[k], &errors[0]);
+            int inliers = countInliers(errors, threshold2);
+            if (inliers <= bestInliers) {
+                continue;
+            }
+
+            bestInliers = inliers;
+            bestModel = models[k];
+            iterations = neededIterations(inliers, n, m, confidence, maxIterations);
+        }
+    }
+
+    if (m > bestInliers) {
+        return false;
+    }
+
+    // refit on all inliers while the support does not shrink
+    score(bestModel, &errors[0]);
+    for (int round = 0; round < 2; ++round) {
+        vector<int> rows;
+        rows.reserve(bestInliers);
+        for (int i = 0; i < n; ++i) {
+            if (errors[i] <= threshold2) {
+                rows.push_back(i);
+            }
+        }
+
+        Model model = bestModel;
+        if (!refit(rows, model)) {
+            break;
+        }
+
+        vector<float> refitErrors(n);
+        score(model, &refitErrors[0]);
+        int inliers = countInliers(refitErrors, threshold2);
+        if (inliers < bestInliers) {
+            break;
+        }
+
+        bestModel = model;
+        bestInliers = inliers;
+        errors.swap(refitErrors);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        mask[i] = (errors[i] <= threshold2) ? 1 : 0;
+    }
+    return true;
+}
+
+}
+
+void sampsonErrors(const cv::Matx33d& F, const float* x1, const float* y1, const float* x2, const float* y2, int n, float* errors){
+    SampsonKernel kernel = {F, x1, y1, x2, y2, errors};
+    forEachLane(n, kernel);
+}
+
+bool findFundamentalMatRansac(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2,
+                              vector<uchar>& mask, cv::Matx33d& F,
+                              double threshold, double confidence, int maxIterations,
+                              const vector<float>* quality)
+{
+    const int n = points1.size();
+    mask.assign(n, 0);
+    if (points2.size() != points1.size() || 7 > n) {
+        return false;
+    }
+
+    // pixel coordinates for the scoring, normalized coordinates for the solvers
+    cv::Matx33d T1 = getNormalization(points1);
+    cv::Matx33d T2 = getNormalization(points2);
+    vector<float> x1(n), y1(n), x2(n), y2(n);
+    vector<double> u1(n), v1(n), u2(n), v2(n);
+    for (int i = 0; i < n; ++i) {
+        x1[i] = points1[i].x;
+        y1[i] = points1[i].y;
+        x2[i] = points2[i].x;
+        y2[i] = points2[i].y;
+        u1[i] = T1(0,0) * x1[i] + T1(0,2);
+        v1[i] = T1(1,1) * y1[i] + T1(1,2);
+        u2[i] = T2(0,0) * x2[i] + T2(0,2);
+        v2[i] = T2(1,1) * y2[i] + T2(1,2);
+    }
+    cv::Matx33d T2t = T2.t();
+
+    auto solve = [&](const int* sample, cv::Matx33d* models){
+        int numberOfModels = sevenPoint(&u1[0], &v1[0], &u2[0], &v2[0], sample, models);
+        for (int k = 0; k < numberOfModels; ++k) {
+            models[k] = T2t * models[k] * T1;
+        }
+        return numberOfModels;
+    };
+    auto refit = [&](const vector<int>& rows, cv::Matx33d& model){
+        if (!eightPoint(&u1[0], &v1[0], &u2[0], &v2[0], rows, model)) {
+            return false;
+        }
+        model = T2t * model * T1;
+        return true;
+    };
+    auto score = [&](const cv::Matx33d& model, float* errors){
+        sampsonErrors(model, &x1[0], &y1[0], &x2[0], &y2[0], n, errors);
+    };
+
+    cv::Matx33d bestF;
+    if (!runRansac(7, n, solve, refit, score, threshold * threshold, confidence, maxIterations, quality, mask, bestF)) {
+        return false;
+    }
+
+    // same scale as cv::findFundamentalMat
+    F = bestF;
+    if (DBL_EPSILON < std::fabs(F(2,2))) {
+        F = F * (1. / F(2,2));
+    }
+    return true;
+}
+
+bool findEssentialMatRansac(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2,
+                            vector<uchar>& mask, cv::Matx33d& E,
+                            double threshold, double confidence, int maxIterations,
+                            const vector<float>* quality)
+{
+    const int n = points1.size();
+    mask.assign(n, 0);
+    if (points2.size() != points1.size() || 5 > n) {
+        return false;
+    }
+
+    // no hartley normalization here, it would destroy the structure of E
+    vector<float> x1(n), y1(n), x2(n), y2(n);
+    vector<double> u1(n), v1(n), u2(n), v2(n);
+    for (int i = 0; i < n; ++i) {
+        u1[i] = x1[i] = points1[i].x;
+        v1[i] = y1[i] = points1[i].y;
+        u2[i] = x2[i] = points2[i].x;
+        v2[i] = y2[i] = points2[i].y;
+    }
+
+    auto solve = [&](const int* sample, cv::Matx33d* models){
+        return fivePoint(&u1[0], &v1[0], &u2[0], &v2[0], sample, models);
+    };
+    auto refit = [&](const vector<int>& rows, cv::Matx33d& model){
+        if (!eightPoint(&u1[0], &v1[0], &u2[0], &v2[0], rows, model)) {
+            return false;
+        }
+        // nearest essential matrix: singular values (1, 1, 0)
+        cv::Matx31d w;
+        cv::Matx33d u, vt;
+        cv::SVD::compute(model, w, u, vt);
+        model = u * cv::Matx33d::diag(cv::Matx31d(1, 1, 0)) * vt;
+        return true;
+    };
+    auto score = [&](const cv::Matx33d& model, float* errors){
+        sampsonErrors(model, &x1[0], &y1[0], &x2[0], &y2[0], n, errors);
+    };
+
+    if (!runRansac(5, n, solve, refit, score, threshold * threshold, confidence, maxIterations, quality, mask, E)) {
+        return false;
+    }
+
+    // unit frobenius norm, the sign is arbitrary
+    E = E * (1. / cv::norm(E));
+    return true;
+}
+
+bool findRigMotionRansac(const vector<cv::Point3f>& cloud1, const vector<cv::Point3f>& cloud2,
+                         const vector<cv::Point2f>& points_L2, const vector<cv::Point2f>& points_R2,
+                         const cv::Matx33d& K_L, const cv::Matx33d& K_R, const cv::Matx33d& R_LR, const cv::Vec3d& T_LR,
+                         vector<uchar>& mask, cv::Matx33d& R, cv::Vec3d& t,
+                         double threshold, double confidence, int maxIterations,
+                         const vector<float>* quality)
+{
+    const int n = cloud1.size();
+    mask.assign(n, 0);
+    if (cloud2.size() != cloud1.size() || points_L2.size() != cloud1.size() || points_R2.size() != cloud1.size() || 3 > n) {
+        return false;
+    }
+
+    vector<float> X1(n), Y1(n), Z1(n), X2(n), Y2(n), Z2(n), xL(n), yL(n), xR(n), yR(n);
+    for (int i = 0; i < n; ++i) {
+        X1[i] = cloud1[i].x;
+        Y1[i] = cloud1[i].y;
+        Z1[i] = cloud1[i].z;
+        X2[i] = cloud2[i].x;
+        Y2[i] = cloud2[i].y;
+        Z2[i] = cloud2[i].z;
+        xL[i] = points_L2[i].x;
+        yL[i] = points_L2[i].y;
+        xR[i] = points_R2[i].x;
+        yR[i] = points_R2[i].y;
+    }
+
+    auto solve = [&](const int* sample, cv::Matx34d* models){
+        return rigidMotion(&X1[0], &Y1[0], &Z1[0], &X2[0], &Y2[0], &Z2[0], sample, 3, models[0]) ? 1 : 0;
+    };
+    auto refit = [&](const vector<int>& rows, cv::Matx34d& model){
+        if (6 > rows.size()) {
+            return false;
+        }
+        refineMotion(&X1[0], &Y1[0], &Z1[0], &xL[0], &yL[0], &xR[0], &yR[0], &rows[0], rows.size(), K_L, K_R, R_LR, T_LR, model);
+        return true;
+    };
+    auto score = [&](const cv::Matx34d& model, float* errors){
+        // [R_LR | T_LR] [R | t]
+        cv::Matx34d right = R_LR * model;
+        right(0,3) += T_LR[0];
+        right(1,3) += T_LR[1];
+        right(2,3) += T_LR[2];
+        rigReprojectionErrors(K_L * model, K_R * right, &X1[0], &Y1[0], &Z1[0], &xL[0], &yL[0], &xR[0], &yR[0], n, errors);
+    };
+
+    cv::Matx34d motion;
+    if (!runRansac(3, n, solve, refit, score, 2 * threshold * threshold, confidence, maxIterations, quality, mask, motion)) {
+        return false;
+    }
+
+    R = cv::Matx33d(motion(0,0), motion(0,1), motion(0,2),
+                    motion(1,0), motion(1,1), motion(1,2),
+                    motion(2,0), motion(2,1), motion(2,2));
+    t = cv::Vec3d(motion(0,3), motion(1,3), motion(2,3));
+    return true;
+}
+
+bool findPoseRansac(const vector<cv::Point3f>& objectPoints, const vector<cv::Point2f>& imagePoints, const cv::Matx33d& K,
+                    vector<uchar>& mask, cv::Matx33d& R, cv::Vec3d& t, bool useGuess,
+                    double threshold, double confidence, int maxIterations,
+                    const vector<float>* quality)
+{
+    const int n = objectPoints.size();
+    mask.assign(n, 0);
+    if (imagePoints.size() != objectPoints.size() || 3 > n) {
+        return false;
+    }
+
+    // bearing vectors K^-1 x for the solver, pixel coordinates for the scoring
+    cv::Matx33d KInv = K.inv();
+    vector<float> X(n), Y(n), Z(n), x(n), y(n);
+    vector<double> jx(n), jy(n), jz(n);
+    for (int i = 0; i < n; ++i) {
+        X[i] = objectPoints[i].x;
+        Y[i] = objectPoints[i].y;
+        Z[i] = objectPoints[i].z;
+        x[i] = imagePoints[i].x;
+        y[i] = imagePoints[i].y;
+        cv::Vec3d j = KInv * cv::Vec3d(x[i], y[i], 1);
+        j *= 1. / cv::norm(j);
+        jx[i] = j[0];
+        jy[i] = j[1];
+        jz[i] = j[2];
+    }
+
+    auto solve = [&](const int* sample, cv::Matx34d* models){
+        return p3p(&jx[0], &jy[0], &jz[0], &X[0], &Y[0], &Z[0], sample, models);
+    };
+    auto refit = [&](const vector<int>& rows, cv::Matx34d& model){
+        if (6 > rows.size()) {
+            return false;
+        }
+        refineMotion(&X[0], &Y[0], &Z[0], &x[0], &y[0], 0, 0, &rows[0], rows.size(), K, K, cv::Matx33d::eye(), cv::Vec3d(0, 0, 0), model);
+        return true;
+    };
+    auto score = [&](const cv::Matx34d& model, float* errors){
+        reprojectionErrors(K * model, &X[0], &Y[0], &Z[0], &x[0], &y[0], n, errors);
+    };
+
+    cv::Matx34d guess(R(0,0), R(0,1), R(0,2), t[0],
+                      R(1,0), R(1,1), R(1,2), t[1],
+                      R(2,0), R(2,1), R(2,2), t[2]);
+    cv::Matx34d motion;
+    if (!runRansac(3, n, solve, refit, score, threshold * threshold, confidence, maxIterations, quality, mask, motion,
+                   useGuess ? &guess : 0)) {
+        return false;
+    }
+
+    R = cv::Matx33d(motion(0,0), motion(0,1), motion(0,2),
+                    motion(1,0), motion(1,1), motion(1,2),
+                    motion(2,0), motion(2,1), motion(2,2));
+    t = cv::Vec3d(motion(0,3), motion(1,3), motion(2,3));
+    return true;
+}
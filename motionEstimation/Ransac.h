@@ -0,0 +1,56 @@
+#ifndef RANSAC_H
+#define RANSAC_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// squared sampson distance of the correspondences (x1[i], y1[i]) <-> (x2[i], y2[i]) to the
+// epipolar geometry x2^T F x1 = 0 (structure of arrays, vectorized)
+void sampsonErrors(const cv::Matx33d& F, const float* x1, const float* y1, const float* x2, const float* y2, int n, float* errors);
+
+// RANSAC estimation of the fundamental matrix x2^T F x1 = 0 (pixel coordinates): 7 point samples,
+// inliers have a sampson distance below threshold (pixel), the number of iterations adapts to the
+// inlier ratio until confidence is reached. the best model is refitted with the 8 point algorithm
+// on all inliers. with quality (one value per point, higher is better, e.g. the lk min eigenvalue)
+// the samples are drawn PROSAC like from the best points first. mask is 1 for the inliers.
+bool findFundamentalMatRansac(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2,
+                              vector<uchar>& mask, cv::Matx33d& F,
+                              double threshold = 3., double confidence = 0.99, int maxIterations = 1000,
+                              const vector<float>* quality = 0);
+
+// RANSAC estimation of the essential matrix x2^T E x1 = 0 from calibrated points (K^-1 x, see
+// normalizePoints) with the 5 point algorithm of nister. threshold is the sampson distance in
+// normalized coordinates (pixel threshold / focal length), the refit is the 8 point algorithm
+// projected onto singular values (1, 1, 0). E has unit norm, everything else as findFundamentalMatRansac.
+bool findEssentialMatRansac(const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2,
+                            vector<uchar>& mask, cv::Matx33d& E,
+                            double threshold, double confidence = 0.999, int maxIterations = 1000,
+                            const vector<float>* quality = 0);
+
+// RANSAC estimation of the stereo rig motion X2 = R X1 + t (left camera coordinates, metric like the clouds)
+// from the triangulated stereo points of both frames: 3 point samples of cloud1 <-> cloud2 give a hypothesis
+// (kabsch), which is scored by the reprojection of cloud1 into the left and the right image of frame 2
+// (rig [R_LR | T_LR] from left to right camera). inliers have a root mean square reprojection error of
+// both cameras below threshold (pixel), the best hypothesis is refined on all inliers (gauss newton on the reprojection error). quality and mask as in
+// findFundamentalMatRansac.
+bool findRigMotionRansac(const vector<cv::Point3f>& cloud1, const vector<cv::Point3f>& cloud2,
+                         const vector<cv::Point2f>& points_L2, const vector<cv::Point2f>& points_R2,
+                         const cv::Matx33d& K_L, const cv::Matx33d& K_R, const cv::Matx33d& R_LR, const cv::Vec3d& T_LR,
+                         vector<uchar>& mask, cv::Matx33d& R, cv::Vec3d& t,
+                         double threshold = 2., double confidence = 0.99, int maxIterations = 1000,
+                         const vector<float>* quality = 0);
+
+// RANSAC estimation of the camera pose x ~ K (R X + t) from 3d <-> 2d correspondences with the P3P solver of
+// grunert (3 point samples, up to 4 hypotheses each). inliers have a reprojection error below threshold
+// (pixel), the best hypothesis is refined on all inliers (gauss newton on the reprojection error). with
+// useGuess the pose in R / t is scored first, a good guess ends the search after a few samples.
+// quality and mask as in findFundamentalMatRansac.
+bool findPoseRansac(const vector<cv::Point3f>& objectPoints, const vector<cv::Point2f>& imagePoints, const cv::Matx33d& K,
+                    vector<uchar>& mask, cv::Matx33d& R, cv::Vec3d& t, bool useGuess = false,
+                    double threshold = 2., double confidence = 0.99, int maxIterations = 1000,
+                    const vector<float>* quality = 0);
+
+#endif // RANSAC_H
@@ -0,0 +1,104 @@
+#ifndef RIGIDTRANSFORM_H
+#define RIGIDTRANSFORM_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// rigid transformation x' = R * x + t on the stack. replaces the 3x4 / 4x4 cv::Mat pose
+// matrices (composeProjectionMat, getAbsPos, decomposeProjectionMat) for the pose chaining.
+struct RigidTransform {
+    cv::Matx33f R;
+    cv::Vec3f t;
+
+    RigidTransform()
+        : R(cv::Matx33f::eye()), t(0, 0, 0)
+    {
+    }
+
+    RigidTransform(const cv::Matx33f& R, const cv::Vec3f& t)
+        : R(R), t(t)
+    {
+    }
+
+    // T 3x1 and R 3x3 of any float or double type (same argument order as composeProjectionMat)
+    RigidTransform(const cv::Mat& T, const cv::Mat& R){
+        cv::Mat_<float> T_(T.reshape(1, 3)), R_(R);
+        for (int i = 0; i < 9; ++i) {
+            this->R.val[i] = R_(i / 3, i % 3);
+        }
+        for (int i = 0; i < 3; ++i) {
+            t(i) = T_(i);
+        }
+    }
+
+    // [R|t] of a 3x4 projection matrix or 4x4 pose matrix
+    static RigidTransform fromMat(const cv::Mat& P){
+        cv::Mat_<float> P_(P);
+        RigidTransform transform;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                transform.R(r, c) = P_(r, c);
+            }
+            transform.t(r) = P_(r, 3);
+        }
+        return transform;
+    }
+
+    // first other, then this
+    RigidTransform operator*(const RigidTransform& other) const {
+        return RigidTransform(R * other.R, R * other.t + t);
+    }
+
+    RigidTransform inverse() const {
+        cv::Matx33f R_t = R.t();
+        return RigidTransform(R_t, -(R_t * t));
+    }
+
+    cv::Point3f operator()(const cv::Point3f& p) const {
+        return cv::Point3f(R(0,0)*p.x + R(0,1)*p.y + R(0,2)*p.z + t(0),
+                           R(1,0)*p.x + R(1,1)*p.y + R(1,2)*p.z + t(1),
+                           R(2,0)*p.x + R(2,1)*p.y + R(2,2)*p.z + t(2));
+    }
+
+    // points and transformed may be the same vector
+    void transform(const vector<cv::Point3f>& points, vector<cv::Point3f>& transformed) const {
+        transformed.resize(points.size());
+        for (unsigned int i = 0; i < points.size(); ++i) {
+            transformed[i] = (*this)(points[i]);
+        }
+    }
+
+    // cv::Mat api
+    cv::Mat T_Mat() const { return cv::Mat(t, true); }
+    cv::Mat R_Mat() const { return cv::Mat(R, true); }
+
+    // 3x4 [R|t], see composeProjectionMat
+    cv::Mat toProjectionMat() const {
+        cv::Mat P(3, 4, CV_32F);
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                P.at<float>(r, c) = R(r, c);
+            }
+            P.at<float>(r, 3) = t(r);
+        }
+        return P;
+    }
+
+    // 4x4 [R|t; 0 0 0 1]
+    cv::Mat toMat() const {
+        cv::Mat P = cv::Mat::eye(4, 4, CV_32F);
+        toProjectionMat().copyTo(P.rowRange(0, 3));
+        return P;
+    }
+};
+
+// element-wise mean of both transformations (R is not orthonormalized again), the same as
+// the mean of the 4x4 pose matrices
+inline RigidTransform meanTransform(const RigidTransform& a, const RigidTransform& b){
+    return RigidTransform((a.R + b.R) * 0.5f, (a.t + b.t) * 0.5f);
+}
+
+#endif // RIGIDTRANSFORM_H
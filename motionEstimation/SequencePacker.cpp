@@ -0,0 +1,30 @@
+#include "StereoSequence.h"
+
+#include <cstring>
+
+// packs the left/ and right/ images of a sequence into one stereo sequence file, see StereoSequence.h
+// usage: SequencePacker [sequence path] [output file] [lz4]
+//        (default: path of data/config.yml, <path>sequence.seq, raw)
+
+int main(int argc, char** argv){
+    string dataPath;
+    if (1 < argc) {
+        dataPath = argv[1];
+    } else {
+        cv::FileStorage config("data/config.yml", cv::FileStorage::READ);
+        config["path"] >> dataPath;
+        config.release();
+    }
+
+    string file = (2 < argc) ? string(argv[2]) : dataPath + "sequence.seq";
+    SequenceCompression compression = (3 < argc && 0 == strcmp(argv[3], "lz4")) ? SEQUENCE_LZ4 : SEQUENCE_RAW;
+
+    if (!packStereoSequence(dataPath, file, compression)) {
+        std::cout << "Could not pack " << dataPath << " to " << file << std::endl;
+        return 1;
+    }
+
+    StereoSequence sequence(file);
+    std::cout << "packed " << sequence.size() << " stereo frames to " << file << std::endl;
+    return 0;
+}
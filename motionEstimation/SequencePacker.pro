@@ -0,0 +1,21 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+QMAKE_CXXFLAGS += -std=c++11 -fPIC -g -D_GNULINUX -O3
+SOURCES += \
+    SequencePacker.cpp \
+    StereoSequence.cpp \
+    Utility.cpp
+
+HEADERS += \
+    StereoSequence.h \
+    Utility.h \
+    RigidTransform.h
+
+unix:!macx: LIBS += -lopencv_core \
+                    -lopencv_imgproc \
+                    -lopencv_highgui \
+                    -lopencv_features2d \
+                    -llz4
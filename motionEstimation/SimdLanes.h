@@ -0,0 +1,72 @@
+#ifndef SIMDLANES_H
+#define SIMDLANES_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+// one lane per point, computed in double. point kernels are written once as a template over
+// the lane type and called with Lane4 (AVX), Lane2 (SSE2) and Lane1 for the remaining points.
+struct Lane1 {
+    double v;
+    Lane1(double d) : v(d) {}
+    static Lane1 load(const float* p) { return Lane1(*p); }
+    void store(float* p) const { *p = v; }
+};
+inline Lane1 operator+(Lane1 a, Lane1 b) { return Lane1(a.v + b.v); }
+inline Lane1 operator-(Lane1 a, Lane1 b) { return Lane1(a.v - b.v); }
+inline Lane1 operator*(Lane1 a, Lane1 b) { return Lane1(a.v * b.v); }
+inline Lane1 operator/(Lane1 a, Lane1 b) { return Lane1(a.v / b.v); }
+
+#ifdef __SSE2__
+struct Lane2 {
+    __m128d v;
+    Lane2(__m128d d) : v(d) {}
+    Lane2(double d) : v(_mm_set1_pd(d)) {}
+    static Lane2 load(const float* p) { return Lane2(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p)))); }
+    void store(float* p) const { _mm_storel_pi((__m64*)p, _mm_cvtpd_ps(v)); }
+};
+inline Lane2 operator+(Lane2 a, Lane2 b) { return Lane2(_mm_add_pd(a.v, b.v)); }
+inline Lane2 operator-(Lane2 a, Lane2 b) { return Lane2(_mm_sub_pd(a.v, b.v)); }
+inline Lane2 operator*(Lane2 a, Lane2 b) { return Lane2(_mm_mul_pd(a.v, b.v)); }
+inline Lane2 operator/(Lane2 a, Lane2 b) { return Lane2(_mm_div_pd(a.v, b.v)); }
+#endif
+
+#ifdef __AVX__
+struct Lane4 {
+    __m256d v;
+    Lane4(__m256d d) : v(d) {}
+    Lane4(double d) : v(_mm256_set1_pd(d)) {}
+    static Lane4 load(const float* p) { return Lane4(_mm256_cvtps_pd(_mm_loadu_ps(p))); }
+    void store(float* p) const { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); }
+};
+inline Lane4 operator+(Lane4 a, Lane4 b) { return Lane4(_mm256_add_pd(a.v, b.v)); }
+inline Lane4 operator-(Lane4 a, Lane4 b) { return Lane4(_mm256_sub_pd(a.v, b.v)); }
+inline Lane4 operator*(Lane4 a, Lane4 b) { return Lane4(_mm256_mul_pd(a.v, b.v)); }
+inline Lane4 operator/(Lane4 a, Lane4 b) { return Lane4(_mm256_div_pd(a.v, b.v)); }
+#endif
+
+// runs kernel.run<V>(i) for the points i = 0 .. n - 1: Lane4 while at least 4 points are left (AVX), then
+// Lane2 (SSE2), then Lane1 for the rest. run<V>(i) computes the points i .. i + lanes of V - 1
+template <class Kernel>
+inline void forEachLane(int n, const Kernel& kernel){
+    int i = 0;
+#ifdef __AVX__
+    for (; i + 4 <= n; i += 4) {
+        kernel.template run<Lane4>(i);
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 2 <= n; i += 2) {
+        kernel.template run<Lane2>(i);
+    }
+#endif
+    for (; i < n; ++i) {
+        kernel.template run<Lane1>(i);
+    }
+}
+
+#endif // SIMDLANES_H
@@ -0,0 +1,198 @@
+#include "StereoSequence.h"
+#include "Utility.h"
+
+#include <fstream>
+#include <cstring>
+
+#include <lz4.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char SEQUENCE_MAGIC[4] = {'S','E','Q','1'};
+
+static bool writeImage(std::ofstream& stream, const cv::Mat& image, SequenceCompression compression, uint64_t& offset, uint64_t& size){
+    offset = stream.tellp();
+    size = 0;
+    if (image.empty()) {
+        return true;
+    }
+
+    cv::Mat continuous = image.isContinuous() ? image : image.clone();
+    int rawSize = continuous.rows * continuous.cols;
+
+    if (SEQUENCE_LZ4 == compression) {
+        std::vector<char> compressed(LZ4_compressBound(rawSize));
+        int compressedSize = LZ4_compress_default((const char*)continuous.data, &compressed[0], rawSize, compressed.size());
+        if (0 >= compressedSize) {
+            return false;
+        }
+        stream.write(&compressed[0], compressedSize);
+        size = compressedSize;
+    } else {
+        stream.write((const char*)continuous.data, rawSize);
+        size = rawSize;
+    }
+
+    return stream.good();
+}
+
+bool packStereoSequence(const string& dataPath, const string& file, SequenceCompression compression){
+    std::vector<string> filenames_left, filenames_right;
+    getFiles(dataPath + "left/", filenames_left);
+    getFiles(dataPath + "right/", filenames_right);
+
+    SequenceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEQUENCE_MAGIC, sizeof(header.magic));
+    header.frames = std::min(filenames_left.size(), filenames_right.size());
+    header.compression = compression;
+
+    std::vector<SequenceIndexEntry> index(header.frames);
+    memset(&index[0], 0, index.size() * sizeof(SequenceIndexEntry));
+
+    std::ofstream stream(file.c_str(), std::ios::binary);
+    if (!stream || 0 == header.frames) {
+        return false;
+    }
+
+    // reserve header and index, both are written again when all sizes are known
+    stream.write((const char*)&header, sizeof(header));
+    stream.write((const char*)&index[0], index.size() * sizeof(SequenceIndexEntry));
+
+    for (int frame = 0; frame < header.frames; ++frame) {
+        cv::Mat image_L = cv::imread(dataPath + "left/" + filenames_left[frame],0);
+        cv::Mat image_R = cv::imread(dataPath + "right/"+ filenames_right[frame],0);
+
+        if (0 == header.rows && image_L.data) {
+            header.rows = image_L.rows;
+            header.cols = image_L.cols;
+        }
+
+        // all images of a sequence have the same size
+        if (image_L.data && (image_L.rows != header.rows || image_L.cols != header.cols)) {
+            std::cout << "Error: size of " << filenames_left[frame] << " differs from the first frame" << std::endl;
+            image_L.release();
+        }
+        if (image_R.data && (image_R.rows != header.rows || image_R.cols != header.cols)) {
+            std::cout << "Error: size of " << filenames_right[frame] << " differs from the first frame" << std::endl;
+            image_R.release();
+        }
+
+        if (!writeImage(stream, image_L, compression, index[frame].offset_L, index[frame].size_L) ||
+                !writeImage(stream, image_R, compression, index[frame].offset_R, index[frame].size_R)) {
+            return false;
+        }
+    }
+
+    stream.seekp(0);
+    stream.write((const char*)&header, sizeof(header));
+    stream.write((const char*)&index[0], index.size() * sizeof(SequenceIndexEntry));
+
+    return stream.good();
+}
+
+StereoSequence::StereoSequence()
+    : _data(0), _size(0), _header(0), _index(0)
+{
+}
+
+StereoSequence::StereoSequence(const string& file)
+    : _data(0), _size(0), _header(0), _index(0)
+{
+    open(file);
+}
+
+StereoSequence::~StereoSequence(){
+    close();
+}
+
+bool StereoSequence::open(const string& file){
+    close();
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (0 > fd) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (0 != fstat(fd, &fileStat) || (size_t)fileStat.st_size < sizeof(SequenceHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    // private writable mapping: raw images can be handed out as cv::Mat without copy,
+    // a write to such an image only changes the process' copy of the page
+    void* data = mmap(0, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data) {
+        return false;
+    }
+
+    const SequenceHeader* header = (const SequenceHeader*)data;
+    if (0 != memcmp(header->magic, SEQUENCE_MAGIC, sizeof(header->magic)) || 0 > header->frames ||
+            (size_t)fileStat.st_size < sizeof(SequenceHeader) + header->frames * sizeof(SequenceIndexEntry)) {
+        std::cout << "Error: " << file << " is not a stereo sequence" << std::endl;
+        munmap(data, fileStat.st_size);
+        return false;
+    }
+
+    // sequential access is the common case
+    madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+
+    _data = (char*)data;
+    _size = fileStat.st_size;
+    _header = header;
+    _index = (const SequenceIndexEntry*)(_data + sizeof(SequenceHeader));
+
+    return true;
+}
+
+void StereoSequence::close(){
+    if (_data) {
+        munmap(_data, _size);
+    }
+    _data = 0;
+    _size = 0;
+    _header = 0;
+    _index = 0;
+}
+
+int StereoSequence::size() const {
+    return _header ? _header->frames : 0;
+}
+
+bool StereoSequence::readImage(uint64_t offset, uint64_t size, cv::Mat& image) const {
+    image.release();
+    if (0 == size || offset + size > _size) {
+        return false;
+    }
+
+    if (SEQUENCE_LZ4 == _header->compression) {
+        image.create(_header->rows, _header->cols, CV_8UC1);
+        int rawSize = _header->rows * _header->cols;
+        if (rawSize != LZ4_decompress_safe(_data + offset, (char*)image.data, size, rawSize)) {
+            image.release();
+            return false;
+        }
+    } else {
+        if (size != (uint64_t)_header->rows * _header->cols) {
+            return false;
+        }
+        image = cv::Mat(_header->rows, _header->cols, CV_8UC1, _data + offset);
+    }
+
+    return true;
+}
+
+bool StereoSequence::getFrame(int frame, cv::Mat& image_L, cv::Mat& image_R) const {
+    if (0 > frame || size() <= frame) {
+        return false;
+    }
+
+    readImage(_index[frame].offset_L, _index[frame].size_L, image_L);
+    readImage(_index[frame].offset_R, _index[frame].size_R, image_R);
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef STEREOSEQUENCE_H
+#define STEREOSEQUENCE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+// single file container for a stereo sequence:
+//   SequenceHeader | SequenceIndexEntry[frames] | image data ...
+// all images are 8 bit grayscale of the same size, stored raw or LZ4 compressed.
+// the index allows random access without reading the whole file.
+
+enum SequenceCompression {
+    SEQUENCE_RAW = 0,
+    SEQUENCE_LZ4 = 1
+};
+
+struct SequenceHeader {
+    char magic[4];          // "SEQ1"
+    int32_t frames;
+    int32_t rows;
+    int32_t cols;
+    int32_t compression;    // SequenceCompression
+    int32_t reserved;
+};
+
+struct SequenceIndexEntry {
+    uint64_t offset_L;      // from the beginning of the file
+    uint64_t size_L;        // 0 if the image couldn't be read
+    uint64_t offset_R;
+    uint64_t size_R;
+};
+
+// pack the images of dataPath + "left/" and "right/" (getFiles order) into one sequence file
+bool packStereoSequence(const string& dataPath, const string& file, SequenceCompression compression);
+
+// memory mapped reader. getFrame can be called from several threads.
+class StereoSequence {
+public:
+    StereoSequence();
+    StereoSequence(const string& file);
+    ~StereoSequence();
+
+    bool open(const string& file);
+    void close();
+    bool isOpen() const { return 0 != _data; }
+
+    int size() const;
+
+    // raw frames are returned without copy (copy on write mapping, only valid while the sequence is open),
+    // compressed frames are decompressed.
+    // images are empty if the frame is not stored (same as cv::imread). returns false if frame is out of range
+    bool getFrame(int frame, cv::Mat& image_L, cv::Mat& image_R) const;
+
+private:
+    StereoSequence(const StereoSequence&);
+    StereoSequence& operator=(const StereoSequence&);
+
+    bool readImage(uint64_t offset, uint64_t size, cv::Mat& image) const;
+
+    char* _data;
+    size_t _size;
+    const SequenceHeader* _header;
+    const SequenceIndexEntry* _index;
+};
+
+#endif // STEREOSEQUENCE_H
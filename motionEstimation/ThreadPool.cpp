@@ -0,0 +1,55 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int numberOfThreads)
+    : _stop(false)
+{
+    if (0 == numberOfThreads) {
+        numberOfThreads = std::max(1u, thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < numberOfThreads; ++i) {
+        _workers.push_back(thread(&ThreadPool::run, this));
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _taskAvailable.notify_all();
+
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+future<void> ThreadPool::enqueue(const function<void()>& task){
+    packaged_task<void()> packagedTask(task);
+    future<void> result = packagedTask.get_future();
+    {
+        lock_guard<mutex> lock(_mutex);
+        _tasks.push(std::move(packagedTask));
+    }
+    _taskAvailable.notify_one();
+
+    return result;
+}
+
+void ThreadPool::run(){
+    while (true){
+        packaged_task<void()> task;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _taskAvailable.wait(lock, [this]{ return _stop || !_tasks.empty(); });
+
+            // finish all queued tasks before stopping
+            if (_tasks.empty()) {
+                break;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+// fixed number of worker threads that run queued tasks. enqueue() returns a
+// future, call get() on it to join the task (exceptions are rethrown there).
+class ThreadPool {
+public:
+    // 0 threads: one thread per core
+    ThreadPool(unsigned int numberOfThreads = 0);
+    ~ThreadPool();
+
+    future<void> enqueue(const function<void()>& task);
+
+    unsigned int size() const { return _workers.size(); }
+
+private:
+    void run();
+
+    vector<thread> _workers;
+    queue<packaged_task<void()> > _tasks;
+    bool _stop;
+
+    mutex _mutex;
+    condition_variable _taskAvailable;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,122 @@
+#include "Timing.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+namespace {
+
+std::atomic<bool> timingEnabled(false);
+std::chrono::steady_clock::time_point timingStart;
+
+std::mutex samplesMutex;
+std::map<string, std::vector<double> > samples;
+
+// value at fraction p (0..1) of the sorted samples
+double percentile(std::vector<double>& values, double p){
+    unsigned int n = std::min<unsigned int>(values.size() - 1, p * values.size());
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
+
+}
+
+void enableTiming(){
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    samples.clear();
+    timingStart = std::chrono::steady_clock::now();
+    timingEnabled = true;
+}
+
+bool isTimingEnabled(){
+    return timingEnabled;
+}
+
+void addStageTime(const char* stage, double seconds){
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    samples[stage].push_back(seconds);
+}
+
+bool writeTimingReport(const string& file){
+    if (!timingEnabled) {
+        return false;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - timingStart).count();
+
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    std::ofstream stream(file.c_str());
+    if (!stream) {
+        std::cout << "Could not write timing report " << file << std::endl;
+        return false;
+    }
+
+    unsigned int frames = samples.count("frame") ? samples["frame"].size() : 0;
+
+    stream << "{\n";
+    stream << "  \"frames\": " << frames << ",\n";
+    stream << "  \"seconds\": " << elapsed << ",\n";
+    stream << "  \"fps\": " << (0 < elapsed ? frames / elapsed : 0) << ",\n";
+    stream << "  \"stages\": {";
+
+    bool first = true;
+    for (std::map<string, std::vector<double> >::iterator it = samples.begin(); it != samples.end(); ++it) {
+        std::vector<double>& values = it->second;
+        if (values.empty()) {
+            continue;
+        }
+
+        double sum = 0, max = 0;
+        for (unsigned int i = 0; i < values.size(); ++i) {
+            sum += values[i];
+            max = std::max(max, values[i]);
+        }
+
+        // all latencies in milliseconds
+        stream << (first ? "\n" : ",\n");
+        stream << "    \"" << it->first << "\": {"
+               << "\"count\": " << values.size()
+               << ", \"mean_ms\": " << 1000 * sum / values.size()
+               << ", \"p50_ms\": " << 1000 * percentile(values, 0.5)
+               << ", \"p99_ms\": " << 1000 * percentile(values, 0.99)
+               << ", \"max_ms\": " << 1000 * max
+               << "}";
+        first = false;
+    }
+    stream << "\n  }\n}\n";
+
+    return stream.good();
+}
+
+StageTimer::StageTimer(const char* stage)
+    : _stage(stage),
+      _enabled(timingEnabled)
+{
+    if (_enabled) {
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+StageTimer::~StageTimer(){
+    if (_enabled) {
+        addStageTime(_stage, std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+    }
+}
+
+TimingReport::TimingReport(const string& file)
+    : _file(file)
+{
+    if (!_file.empty()) {
+        enableTiming();
+    }
+}
+
+TimingReport::~TimingReport(){
+    if (!_file.empty() && writeTimingReport(_file)) {
+        std::cout << "timing report: " << _file << std::endl;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <string>
+#include <chrono>
+
+using namespace std;
+
+// per stage latencies of the pipeline. a StageTimer adds the duration of its scope to
+// its stage, the statistics (mean, p50, p99, max and frames per second) are written as json.
+// timers do nothing until enableTiming() is called. timers can be used from several threads.
+
+void enableTiming();
+bool isTimingEnabled();
+
+void addStageTime(const char* stage, double seconds);
+
+// json report of all stages. fps is the number of "frame" samples (completed frame pairs, added by
+// the main loop) per second since enableTiming()
+bool writeTimingReport(const string& file);
+
+class StageTimer {
+public:
+    explicit StageTimer(const char* stage);
+    ~StageTimer();
+
+private:
+    StageTimer(const StageTimer&);
+    StageTimer& operator=(const StageTimer&);
+
+    const char* _stage;
+    bool _enabled;
+    chrono::steady_clock::time_point _start;
+};
+
+// writes the report when the run ends (enables timing if file is not empty)
+class TimingReport {
+public:
+    explicit TimingReport(const string& file);
+    ~TimingReport();
+
+private:
+    string _file;
+};
+
+#endif // TIMING_H
@@ -1,4 +1,5 @@
 #include "Triangulation.h"
+#include "SimdLanes.h"
 
 void TriangulateOpenCV(const cv::Mat& P_L,
                        const cv::Mat& P_R,
@@ -109,6 +110,219 @@ cv::Mat_<float> LinearLSTriangulation(
     return X;
 }
 
+namespace {
+
+// smallest det(A^T A) / (n00 n11 n22) of the normal equations that is still solved in closed form.
+// the ratio is 1 for orthogonal columns of A and goes to 0 for (near) parallel rays
+const double minConditioning = 1e-12;
+
+// A X = B of LinearLSTriangulation from the rows [A | -B], solved as (A^T A) X = A^T B with the
+// adjugate of A^T A. conditioning is det(A^T A) / (n00 n11 n22), NaN if a column of A is zero
+template <class V>
+inline void solveNormalEquations(const V a[4][4], V& X, V& Y, V& Z, V& conditioning)
+{
+    // N = A^T A (symmetric), b = A^T B
+    V n00 = a[0][0]*a[0][0] + a[1][0]*a[1][0] + a[2][0]*a[2][0] + a[3][0]*a[3][0];
+    V n01 = a[0][0]*a[0][1] + a[1][0]*a[1][1] + a[2][0]*a[2][1] + a[3][0]*a[3][1];
+    V n02 = a[0][0]*a[0][2] + a[1][0]*a[1][2] + a[2][0]*a[2][2] + a[3][0]*a[3][2];
+    V n11 = a[0][1]*a[0][1] + a[1][1]*a[1][1] + a[2][1]*a[2][1] + a[3][1]*a[3][1];
+    V n12 = a[0][1]*a[0][2] + a[1][1]*a[1][2] + a[2][1]*a[2][2] + a[3][1]*a[3][2];
+    V n22 = a[0][2]*a[0][2] + a[1][2]*a[1][2] + a[2][2]*a[2][2] + a[3][2]*a[3][2];
+    V b0 = V(0.0) - (a[0][0]*a[0][3] + a[1][0]*a[1][3] + a[2][0]*a[2][3] + a[3][0]*a[3][3]);
+    V b1 = V(0.0) - (a[0][1]*a[0][3] + a[1][1]*a[1][3] + a[2][1]*a[2][3] + a[3][1]*a[3][3]);
+    V b2 = V(0.0) - (a[0][2]*a[0][3] + a[1][2]*a[1][3] + a[2][2]*a[2][3] + a[3][2]*a[3][3]);
+
+    // adjugate (symmetric) and determinant
+    V c00 = n11*n22 - n12*n12;
+    V c01 = n02*n12 - n01*n22;
+    V c02 = n01*n12 - n02*n11;
+    V c11 = n00*n22 - n02*n02;
+    V c12 = n01*n02 - n00*n12;
+    V c22 = n00*n11 - n01*n01;
+    V det = n00*c00 + n01*c01 + n02*c02;
+
+    X = (c00*b0 + c01*b1 + c02*b2) / det;
+    Y = (c01*b0 + c11*b1 + c12*b2) / det;
+    Z = (c02*b0 + c12*b1 + c22*b2) / det;
+    conditioning = det / (n00*n11*n22);
+}
+
+struct TriangulateKernel {
+    const cv::Matx34d& P_L;
+    const cv::Matx34d& P_R;
+    const float *x_L, *y_L, *x_R, *y_R;
+    float *X, *Y, *Z, *conditioning;
+
+    template <class V>
+    void run(int i) const {
+        const V u_L = V::load(x_L + i), v_L = V::load(y_L + i);
+        const V u_R = V::load(x_R + i), v_R = V::load(y_R + i);
+
+        // rows of [A | -B]
+        V a[4][4] = {{0,0,0,0},{0,0,0,0},{0,0,0,0},{0,0,0,0}};
+        for (int k = 0; k < 4; ++k) {
+            a[0][k] = u_L * V(P_L(2,k)) - V(P_L(0,k));
+            a[1][k] = v_L * V(P_L(2,k)) - V(P_L(1,k));
+            a[2][k] = u_R * V(P_R(2,k)) - V(P_R(0,k));
+            a[3][k] = v_R * V(P_R(2,k)) - V(P_R(1,k));
+        }
+
+        V X_(0.0), Y_(0.0), Z_(0.0), c(0.0);
+        solveNormalEquations(a, X_, Y_, Z_, c);
+        X_.store(X + i);
+        Y_.store(Y + i);
+        Z_.store(Z + i);
+        c.store(conditioning + i);
+    }
+};
+
+// [X Y Z W] = Q [x y d 1] with d = x_L - x_R, X / W ...
+struct TriangulateStereoKernel {
+    const cv::Matx44d& Q;
+    const float *x_L, *y_L, *x_R;
+    float *X, *Y, *Z;
+
+    template <class V>
+    void run(int i) const {
+        const V x = V::load(x_L + i), y = V::load(y_L + i);
+        const V d = x - V::load(x_R + i);
+
+        V W = V(Q(3,0))*x + V(Q(3,1))*y + V(Q(3,2))*d + V(Q(3,3));
+        ((V(Q(0,0))*x + V(Q(0,1))*y + V(Q(0,2))*d + V(Q(0,3))) / W).store(X + i);
+        ((V(Q(1,0))*x + V(Q(1,1))*y + V(Q(1,2))*d + V(Q(1,3))) / W).store(Y + i);
+        ((V(Q(2,0))*x + V(Q(2,1))*y + V(Q(2,2))*d + V(Q(2,3))) / W).store(Z + i);
+    }
+};
+
+void toMatx34d(const cv::Mat& P, cv::Matx34d& P64){
+    cv::Mat_<double> P_(P);
+    for (int i = 0; i < 12; ++i) {
+        P64.val[i] = P_(i / 4, i % 4);
+    }
+}
+
+}
+
+void TriangulateLinearBatch(const cv::Matx34d& P_L, const cv::Matx34d& P_R,
+                            const float* x_L, const float* y_L, const float* x_R, const float* y_R,
+                            int n, float* X, float* Y, float* Z)
+{
+    cv::Matx34f P_L32 = P_L, P_R32 = P_R;
+
+    // in blocks, the conditioning of each point on the stack
+    const int BLOCK = 64;
+    float conditioning[BLOCK];
+
+    for (int start = 0; start < n; start += BLOCK) {
+        int size = std::min(BLOCK, n - start);
+        TriangulateKernel kernel = {P_L, P_R, x_L + start, y_L + start, x_R + start, y_R + start,
+                                    X + start, Y + start, Z + start, conditioning};
+        forEachLane(size, kernel);
+
+        // (near) parallel rays, the closed form divided by a vanishing determinant
+        for (int i = 0; i < size; ++i) {
+            if (!(conditioning[i] > minConditioning)) {
+                int j = start + i;
+                cv::Mat_<float> X_ = LinearLSTriangulation(cv::Point3f(x_L[j], y_L[j], 1), P_L32,
+                                                           cv::Point3f(x_R[j], y_R[j], 1), P_R32);
+                X[j] = X_(0);
+                Y[j] = X_(1);
+                Z[j] = X_(2);
+            }
+        }
+    }
+}
+
+bool solveLinearTriangulation(const double a[4][4], double X[3]){
+    Lane1 rows[4][4] = {{a[0][0], a[0][1], a[0][2], a[0][3]},
+                        {a[1][0], a[1][1], a[1][2], a[1][3]},
+                        {a[2][0], a[2][1], a[2][2], a[2][3]},
+                        {a[3][0], a[3][1], a[3][2], a[3][3]}};
+    Lane1 X_(0.0), Y_(0.0), Z_(0.0), conditioning(0.0);
+    solveNormalEquations(rows, X_, Y_, Z_, conditioning);
+    if (!(conditioning.v > minConditioning)) {
+        return false;
+    }
+
+    X[0] = X_.v;
+    X[1] = Y_.v;
+    X[2] = Z_.v;
+    return true;
+}
+
+bool isRectifiedRig(const cv::Mat& K_L, const cv::Mat& K_R, const cv::Mat& R_LR, const cv::Mat& T_LR){
+    if (K_L.empty() || K_R.empty() || R_LR.empty() || T_LR.empty()) {
+        return false;
+    }
+
+    cv::Mat_<double> K_L64(K_L), K_R64(K_R), R64(R_LR), T64(T_LR.reshape(1, 3));
+
+    // rotation angle below 0.01 degree
+    cv::Mat_<double> rvec;
+    cv::Rodrigues(R64, rvec);
+    if (cv::norm(rvec) > 1e-2 * CV_PI / 180) {
+        return false;
+    }
+
+    // baseline along x
+    double baseline = fabs(T64(0));
+    if (0 == baseline || fabs(T64(1)) > 1e-3 * baseline || fabs(T64(2)) > 1e-3 * baseline) {
+        return false;
+    }
+
+    // same focal length (square pixels) and principal row, less than half a pixel apart
+    double f = K_L64(0,0);
+    return fabs(K_L64(1,1) - f) < 0.5 && fabs(K_R64(0,0) - f) < 0.5 && fabs(K_R64(1,1) - f) < 0.5 &&
+            fabs(K_L64(1,2) - K_R64(1,2)) < 0.5 && 0 == K_L64(0,1) && 0 == K_R64(0,1);
+}
+
+void composeRectifiedQ(const cv::Mat& K_L, const cv::Mat& K_R, const cv::Mat& T_LR, cv::Mat& Q){
+    cv::Mat_<double> K_L64(K_L), K_R64(K_R), T64(T_LR.reshape(1, 3));
+    double f = K_L64(0,0);
+    double cx = K_L64(0,2), cy = K_L64(1,2), cx_R = K_R64(0,2);
+    double Tx = T64(0);
+
+    Q = (cv::Mat_<float>(4,4) <<
+         1, 0, 0, -cx,
+         0, 1, 0, -cy,
+         0, 0, 0, f,
+         0, 0, -1 / Tx, (cx - cx_R) / Tx);
+}
+
+void TriangulateStereo(const cv::Mat& Q,
+                       const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R,
+                       vector<cv::Point3f>& pointcloud)
+{
+    cv::Mat_<double> Q64(Q);
+    cv::Matx44d Q_;
+    for (int i = 0; i < 16; ++i) {
+        Q_.val[i] = Q64(i / 4, i % 4);
+    }
+
+    int n = std::min(points_L.size(), points_R.size());
+    pointcloud.resize(n);
+
+    // structure of arrays in blocks on the stack
+    const int BLOCK = 64;
+    float x_L[BLOCK], y_L[BLOCK], x_R[BLOCK], X[BLOCK], Y[BLOCK], Z[BLOCK];
+
+    for (int start = 0; start < n; start += BLOCK) {
+        int size = std::min(BLOCK, n - start);
+        for (int i = 0; i < size; ++i) {
+            x_L[i] = points_L[start + i].x;
+            y_L[i] = points_L[start + i].y;
+            x_R[i] = points_R[start + i].x;
+        }
+
+        TriangulateStereoKernel kernel = {Q_, x_L, y_L, x_R, X, Y, Z};
+        forEachLane(size, kernel);
+
+        for (int j = 0; j < size; ++j) {
+            pointcloud[start + j] = cv::Point3f(X[j], Y[j], Z[j]);
+        }
+    }
+}
+
 //http://pastebin.com/UE6YW39J
 void TriangulatePointsHZ(const cv::Mat& P_L, const cv::Mat& P_R, //normalized PK = K * P
                          const vector<cv::Point2f>& points1,
@@ -117,26 +331,49 @@ void TriangulatePointsHZ(const cv::Mat& P_L, const cv::Mat& P_R, //normalized PK
                          vector<cv::Point3f>& pointcloud)
 {
     // if parameter is 0 triangulate all points
-    if (0 == numberOfTriangulations) {
+    if (0 == numberOfTriangulations || numberOfTriangulations > (int)points1.size()) {
         numberOfTriangulations = points1.size();
     }
 
-    int interval = (points1.size() / numberOfTriangulations);
+    int interval = (points1.size() / std::max(1, numberOfTriangulations));
     if (1 > interval) {
         interval = 1;
     }
 
     pointcloud.clear();
+    if (0 == numberOfTriangulations) {
+        return;
+    }
 
-    vector<cv::Point3f> points1_h, points2_h;
-    cv::convertPointsToHomogeneous(points1, points1_h);
-    cv::convertPointsToHomogeneous(points2, points2_h);
+    cv::Matx34d P_L64, P_R64;
+    toMatx34d(P_L, P_L64);
+    toMatx34d(P_R, P_R64);
+
+    // structure of arrays: x_L | y_L | x_R | y_R | X | Y | Z
+    int n = numberOfTriangulations;
+    vector<float> soa(7 * n);
+    float* x_L = &soa[0];
+    float* y_L = x_L + n;
+    float* x_R = y_L + n;
+    float* y_R = x_R + n;
+    float* X = y_R + n;
+    float* Y = X + n;
+    float* Z = Y + n;
 
     int index = 0;
-    for (unsigned int i=0; i < numberOfTriangulations; ++i ){
-        cv::Mat_<float> X = LinearLSTriangulation(points1_h[index],P_L,points2_h[index],P_R);
-        pointcloud.push_back(cv::Point3f(X(0),X(1),X(2)));
-        index+=interval;
+    for (int i = 0; i < n; ++i) {
+        x_L[i] = points1[index].x;
+        y_L[i] = points1[index].y;
+        x_R[i] = points2[index].x;
+        y_R[i] = points2[index].y;
+        index += interval;
+    }
+
+    TriangulateLinearBatch(P_L64, P_R64, x_L, y_L, x_R, y_R, n, X, Y, Z);
+
+    pointcloud.resize(n);
+    for (int i = 0; i < n; ++i) {
+        pointcloud[i] = cv::Point3f(X[i], Y[i], Z[i]);
     }
 }
 
@@ -16,6 +16,33 @@ using namespace std;
 cv::Mat_<float> LinearLSTriangulation(cv::Point3f u,cv::Matx34f P,
                                        cv::Point3f u1, cv::Matx34f P1);
 
+// batched linear triangulation of n correspondences in structure of arrays form
+// (x_L[i], y_L[i]) <-> (x_R[i], y_R[i]). solves the same least squares system as
+// LinearLSTriangulation through its 3x3 normal equations in closed form (double precision,
+// AVX or SSE2 lanes if available). results are written to X, Y, Z.
+// points whose normal equations are (nearly) singular, e.g. (near) parallel rays, fall back to
+// LinearLSTriangulation (SVD), so X, Y, Z are always finite for finite input.
+void TriangulateLinearBatch(const cv::Matx34d& P_L, const cv::Matx34d& P_R,
+                            const float* x_L, const float* y_L, const float* x_R, const float* y_R,
+                            int n, float* X, float* Y, float* Z);
+
+// least squares solution X of the rows [A | -B] of one linear triangulation (the scalar case of
+// TriangulateLinearBatch). false if the normal equations are (nearly) singular, e.g. parallel rays
+bool solveLinearTriangulation(const double a[4][4], double X[3]);
+
+// true if the stereo rig is rectified: R_LR is (near) identity, the baseline T_LR is along x
+// and both cameras share the focal length and principal row. then stereo correspondences can
+// be triangulated from their x disparity (TriangulateStereo).
+bool isRectifiedRig(const cv::Mat& K_L, const cv::Mat& K_R, const cv::Mat& R_LR, const cv::Mat& T_LR);
+
+// reprojection matrix (like cv::stereoRectify) of a rectified rig with P_L = K_L[I|0], P_R = K_R[I|T_LR]
+void composeRectifiedQ(const cv::Mat& K_L, const cv::Mat& K_R, const cv::Mat& T_LR, cv::Mat& Q);
+
+// rectified stereo triangulation: [X Y Z W] = Q * [x_L y_L (x_L - x_R) 1]
+void TriangulateStereo(const cv::Mat& Q,
+                       const vector<cv::Point2f>& points_L, const vector<cv::Point2f>& points_R,
+                       vector<cv::Point3f>& pointcloud);
+
 void TriangulatePointsHZ(const cv::Mat& P_L, const cv::Mat& P_R,
                          const vector<cv::Point2f>& points1, const vector<cv::Point2f>& points2,
                          int numberOfTriangulations,
@@ -74,29 +74,14 @@ void decomposeRotMat(const cv::Mat& R, float& x, float& y, float& z){
 }
 
 void rotatePointCloud(std::vector<cv::Point3f>& cloud){
-    cv::Mat R = (cv::Mat_<float>(3,3) <<
-                -1, 0, 0,
-                 0,-1, 0,
-                 0, 0, 1);
-    for (auto &i : cloud){
-        cv::Mat point(i);
-        point.convertTo(point, R.type());
-        cv::Mat newPoint = R * point;
-        i = cv::Point3f(newPoint);
-    }
+    cv::Matx33f R(-1, 0, 0,
+                   0,-1, 0,
+                   0, 0, 1);
+    RigidTransform(R, cv::Vec3f(0, 0, 0)).transform(cloud, cloud);
 }
 
 void rotatePointCloud(std::vector<cv::Point3f>& cloud, const cv::Mat P){
-    cv::Mat R, T;
-    decomposeProjectionMat(P, T, R);
-
-    for (auto &i : cloud){
-        cv::Mat point(i);
-        point.convertTo(point, R.type());
-
-        cv::Mat newPoint = R * point + T;
-        i = cv::Point3f(newPoint);
-    }
+    RigidTransform::fromMat(P).transform(cloud, cloud);
 }
 
 void rotateRandT(cv::Mat& Trans, cv::Mat& Rot){
@@ -110,6 +95,21 @@ void rotateRandT(cv::Mat& Trans, cv::Mat& Rot){
     Rot = R * Rot;
 }
 
+// one line per pose: frame1 frame2 and the row major 3x4 matrix [R|T]
+void writeTrajectoryPose(std::ostream& stream, int frame1, int frame2, const cv::Mat& T, const cv::Mat& R){
+    cv::Matx33f R_(R);
+    cv::Vec3f T_(T);
+    stream << frame1 << " " << frame2;
+    for (unsigned int i = 0; i < 3; ++i) {
+        stream << " " << R_(i,0) << " " << R_(i,1) << " " << R_(i,2) << " " << T_(i);
+    }
+    stream << std::endl;
+}
+
+void writeTrajectoryPose(std::ostream& stream, int frame1, int frame2, const RigidTransform& pose){
+    writeTrajectoryPose(stream, frame1, frame2, cv::Mat(pose.t), cv::Mat(pose.R));
+}
+
 void KeyPointsToPoints(const std::vector<cv::KeyPoint>& kps, std::vector<cv::Point2f>& ps) {
     ps.clear();
     for (unsigned int i=0; i<kps.size(); i++) ps.push_back(kps[i].pt);
@@ -5,6 +5,8 @@
 #include <vector>
 #include <opencv2/opencv.hpp>
 
+#include "RigidTransform.h"
+
 
 
 int getFiles (std::string const& dir, std::vector<std::string> &files);
@@ -28,4 +30,7 @@ bool calcCoordinate(cv::Mat_<float> &toReturn,cv::Mat const& Q, cv::Mat const& d
 
 void rotateRandT(cv::Mat& Trans, cv::Mat& Rot);
 
+void writeTrajectoryPose(std::ostream& stream, int frame1, int frame2, const cv::Mat& T, const cv::Mat& R);
+void writeTrajectoryPose(std::ostream& stream, int frame1, int frame2, const RigidTransform& pose);
+
 #endif // UTILITY_H
@@ -1,10 +1,20 @@
 #include "MotionEstimation.h"
+#include "FramePrefetcher.h"
+#include "FeatureTracks.h"
+#include "FrameCache.h"
+#include "DisparityMap.h"
+#include "FrameSource.h"
+#include "Timing.h"
+#include "RigidTransform.h"
+#include "CorrespondenceTable.h"
 #include "Utility.h"
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/core.hpp>
 
 #include <vector>
+#include <memory>
+#include <fstream>
 
 // ************************************
 // ******* Motion Estimation **********
@@ -24,16 +34,139 @@ int main(){
 
     //load config file
     int mode = 0;
-    string dataPath;
+    int prefetchFrames = 4;
+    int minTracks = 50;
+    int threads = 0;
+    int headless = 0;
+    int rectifiedStereo = 1;
+    int fivePoint = 0;
+    int jointRig = 0;
+    double epipolarThreshold = 2;
+    int maxDisparity = 128;
+    string matcher = "lk";
+    int pipeWidth = 0, pipeHeight = 0;
+    int replay = 0, replayBuffer = 4;
+    double replayFps = 25;
+    string dataPath, trajectoryFile, timingFile, sourceType, sequenceFile, videoFile, timestampsFile;
     cv::FileStorage config("data/config.yml", cv::FileStorage::READ);
     config["mode"] >> mode;
     config["path"] >> dataPath;
+    if (!config["prefetchFrames"].empty()) {
+        config["prefetchFrames"] >> prefetchFrames;
+    }
+    if (!config["minTracks"].empty()) {
+        config["minTracks"] >> minTracks;
+    }
+    if (!config["threads"].empty()) {
+        config["threads"] >> threads;
+    }
+    // rectifiedStereo: triangulate stereo points from their disparity if the rig is rectified
+    if (!config["rectifiedStereo"].empty()) {
+        config["rectifiedStereo"] >> rectifiedStereo;
+    }
+    // fivePoint: estimate E directly from calibrated points (5 point RANSAC) instead of E = K^T F K
+    if (!config["fivePoint"].empty()) {
+        config["fivePoint"] >> fivePoint;
+    }
+    // jointRig: mode 1 estimates one metric rig motion from both cameras instead of E_L, E_R and the scale factors
+    if (!config["jointRig"].empty()) {
+        config["jointRig"] >> jointRig;
+    }
+    // epipolarThreshold: max sampson distance (pixel) of a stereo pair to the calibrated F_LR, 0 disables the filter
+    if (!config["epipolarThreshold"].empty()) {
+        config["epipolarThreshold"] >> epipolarThreshold;
+    }
+    // maxDisparity: disparity range (pixel) of the scanline stereo matcher of a rectified rig
+    if (!config["maxDisparity"].empty()) {
+        config["maxDisparity"] >> maxDisparity;
+    }
+    // matcher: "lk" tracks the features into stereo 2, "orb" matches orb descriptors of all four images
+    // instead (for large motion between the frames)
+    if (!config["matcher"].empty()) {
+        config["matcher"] >> matcher;
+    }
+    // headless: no drawing, no pcl viewer and no key input. runs all frames back-to-back
+    if (!config["headless"].empty()) {
+        config["headless"] >> headless;
+    }
+    if (!config["trajectory"].empty()) {
+        config["trajectory"] >> trajectoryFile;
+    }
+    // json report of the per stage latencies, written at the end of the run (empty: no timing)
+    if (!config["timing"].empty()) {
+        config["timing"] >> timingFile;
+    }
+    // input: "images" (left/ and right/ of path), "sequence" (packed file, see SequencePacker),
+    // "video" (side by side video file or camera device) or "pipe" (raw 8 bit pairs on stdin)
+    if (!config["source"].empty()) {
+        config["source"] >> sourceType;
+    }
+    if (!config["sequence"].empty()) {
+        config["sequence"] >> sequenceFile;
+    }
+    if (!config["video"].empty()) {
+        config["video"] >> videoFile;
+    }
+    if (!config["pipeWidth"].empty()) {
+        config["pipeWidth"] >> pipeWidth;
+        config["pipeHeight"] >> pipeHeight;
+    }
+    // replay: release the frames at their original rate like a live camera, frames are dropped if too slow
+    if (!config["replay"].empty()) {
+        config["replay"] >> replay;
+    }
+    if (!config["replayFps"].empty()) {
+        config["replayFps"] >> replayFps;
+    }
+    if (!config["replayTimestamps"].empty()) {
+        config["replayTimestamps"] >> timestampsFile;
+    }
+    if (!config["replayBuffer"].empty()) {
+        config["replayBuffer"] >> replayBuffer;
+    }
     config.release();
 
-    //load file names
-    std::vector<string> filenames_left, filenames_right;
-    getFiles(dataPath + "left/", filenames_left);
-    getFiles(dataPath + "right/", filenames_right);
+    if (sourceType.empty()) {
+        sourceType = sequenceFile.empty() ? "images" : "sequence";
+    }
+
+    std::unique_ptr<FrameSource> source;
+    if ("sequence" == sourceType) {
+        SequenceFrameSource* sequence = new SequenceFrameSource(sequenceFile);
+        source.reset(sequence);
+        if (!sequence->isOpen()) {
+            std::cout << "Could not open " << sequenceFile << ", load images of " << dataPath << std::endl;
+            source.reset(new DirectoryFrameSource(dataPath));
+        }
+    } else if ("video" == sourceType) {
+        source.reset(new VideoFrameSource(videoFile));
+    } else if ("pipe" == sourceType) {
+        source.reset(new PipeFrameSource(pipeWidth, pipeHeight));
+    } else {
+        source.reset(new DirectoryFrameSource(dataPath));
+    }
+
+    std::unique_ptr<FrameSource> replaySource;
+    if (replay) {
+        std::vector<double> timestamps;
+        if (!timestampsFile.empty() && !loadTimestamps(timestampsFile, timestamps)) {
+            std::cout << "Could not load timestamps " << timestampsFile << ", replay with " << replayFps << " fps" << std::endl;
+        }
+        replaySource.reset(new ReplayFrameSource(*source, timestamps, replayFps, replayBuffer));
+    }
+
+    // number of frames, -1 for live or streamed input
+    int numberOfFrames = source->size();
+
+    // decode the next stereo pairs in background while the current pair is processed. a replay is read
+    // directly (it decodes ahead itself), so its drops and latency are measured where the loop takes the frames
+    std::unique_ptr<FramePrefetcher> prefetcher;
+    if (!replaySource) {
+        prefetcher.reset(new FramePrefetcher(*source, prefetchFrames));
+    }
+    auto getFrame = [&](int frame, cv::Mat& image_L, cv::Mat& image_R){
+        return prefetcher ? prefetcher->getFrame(frame, image_L, image_R) : replaySource->read(frame, image_L, image_R);
+    };
 
     // get calibration Matrix K
     cv::Mat K_L, distCoeff_L, K_R, distCoeff_R;
@@ -47,11 +180,16 @@ int main(){
     cv::Mat E_LR, F_LR, R_LR, T_LR;
     loadExtrinsic(dataPath, R_LR, T_LR, E_LR, F_LR);
 
-    // load q matrix
+    // load q matrix (from the binary disparity map if it is converted already)
     cv::Mat Q;
-    cv::FileStorage fs(dataPath + "disparity/disparity_0.yml", cv::FileStorage::READ);
-    fs["Q"] >> Q;
-    fs.release();
+    MappedDisparityMap disparity_0;
+    if (disparity_0.open(dataPath + "disparity/disparity_0.disp")) {
+        Q = disparity_0.Q();
+    } else {
+        cv::FileStorage fs(dataPath + "disparity/disparity_0.yml", cv::FileStorage::READ);
+        fs["Q"] >> Q;
+        fs.release();
+    }
     cout << Q << endl;
 
     //convert all to single precission
@@ -89,18 +227,29 @@ int main(){
     decomposeProjectionMat(P_0, R_0, T_0);
 
     // currentPosition E Mat
-    cv::Mat currentPos_ES_L = cv::Mat::eye(4, 4, CV_32F);
-    cv::Mat currentPos_ES_R = cv::Mat::eye(4, 4, CV_32F);
-    cv::Mat currentPos_ES_mean = cv::Mat::eye(4, 4, CV_32F);
+    RigidTransform currentPos_ES_L;
+    RigidTransform currentPos_ES_R;
+    RigidTransform currentPos_ES_mean;
 
     // currentPosition SOLVE PNP RANSAC
-    cv::Mat currentPos_PnP_L = cv::Mat::eye(4, 4, CV_32F);
-    cv::Mat currentPos_PnP_R = cv::Mat::eye(4, 4, CV_32F);
+    RigidTransform currentPos_PnP_L;
+    RigidTransform currentPos_PnP_R;
 
     // currentPosition TRIANGULATION
-    cv::Mat currentPos_Stereo = cv::Mat::eye(4, 4, CV_32F);
+    RigidTransform currentPos_Stereo;
+
+    if (!headless) {
+        initVisualisation();
+    }
+
+    // estimated camera positions of each frame
+    std::ofstream trajectory;
+    if (!trajectoryFile.empty()) {
+        trajectory.open(trajectoryFile.c_str());
+    }
 
-    initVisualisation();
+    // stage latencies, written when main returns (use headless, key input is timed as well)
+    TimingReport timingReport(timingFile);
 
     // key input
     // stop and play with space and with n go to next frame
@@ -113,12 +262,61 @@ int main(){
     bool skipFrame = true;
     int skipFrameNumber = 0;
 
+    // stereo features which are carried over from stereo 2 to the next stereo 1
+    FeatureTracks tracks(minTracks, 100, 0.001, 20);
+
+    // lk pyramids, stereo correspondences and point clouds of the last frames
+    FrameCache cache(6);
+
+    // rectified rig: stereo points directly from the x disparity
+    if (rectifiedStereo && isRectifiedRig(K_L, K_R, R_LR, T_LR)) {
+        cv::Mat Q_rig;
+        composeRectifiedQ(K_L, K_R, T_LR, Q_rig);
+
+        // the loaded Q has to describe the same rig as the calibration, else the clouds
+        // would differ from the ones of TriangulatePointsHZ
+        bool sameQ = 4 == Q.rows && 4 == Q.cols;
+        for (int i = 0; i < 16 && sameQ; ++i) {
+            float q = Q_rig.at<float>(i / 4, i % 4);
+            sameQ = fabs(Q.at<float>(i / 4, i % 4) - q) <= 1e-3 * fabs(q) + 1e-6;
+        }
+        if (!sameQ) {
+            std::cout << "Q doesn't match the calibration, use Q of the rectified calibration" << std::endl;
+        }
+        cache.setRectified(sameQ ? Q : Q_rig);
+
+        // x_L - x_R = (cx_L - cx_R) - f T_x / Z, new stereo features are matched along the row in this range
+        int infinity = cvRound(K_L.at<float>(0,2) - K_R.at<float>(0,2));
+        if (0 > T_LR.at<float>(0)) {
+            tracks.setRectified(infinity - 2, infinity + maxDisparity);
+        } else {
+            tracks.setRectified(infinity - maxDisparity, infinity + 2);
+        }
+        std::cout << "rectified stereo rig: triangulate from disparity" << std::endl;
+    }
+
+    // worker threads for the tracking stage
+    ThreadPool pool(threads);
+
+    bool orbMatcher = ("orb" == matcher);
+
     while (true){
         frame1 = frame2;
 
+        // latency of a frame pair: from loading stereo 1 through the pose update
+        chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+
         // load stereo1
-        cv::Mat image_L1 = cv::imread(dataPath + "left/" + filenames_left[frame1],0);
-        cv::Mat image_R1 = cv::imread(dataPath + "right/"+ filenames_right[frame1],0);
+        cv::Mat image_L1, image_R1;
+        bool loadedStereo1;
+        {
+            StageTimer timer("loadFrame");
+            loadedStereo1 = getFrame(frame1, image_L1, image_R1);
+        }
+        if (!loadedStereo1) {
+            cout <<  "no more images in sequence"  << std::endl ;
+            break;
+        }
 
         // Check for invalid input
         if(! image_L1.data || !image_R1.data) {
@@ -128,17 +326,17 @@ int main(){
             continue;
         }
 
-        // find points in frame 1 ..
-        std::vector<cv::Point2f> features = getStrongFeaturePoints(image_L1, 100, 0.001, 20);
-        std::vector<cv::Point2f> points_L1_temp, points_R1_temp;
-        refindFeaturePoints(image_L1, image_R1, features, points_L1_temp, points_R1_temp);
+        // find points in frame 1 .. (only detect new ones if too less are tracked from the last frame)
+        if (!orbMatcher) {
+            tracks.prepare(pool, frame1, image_L1, image_R1, cache.pyramid_L(frame1, image_L1), cache.pyramid_R(frame1, image_R1));
 
-        // skip frame if no features are found in both images
-        if (10 > points_L1_temp.size()) {
-            cout <<  "Could not find more than features in stereo 1: "  << std::endl ;
-            ++frame1;
-            frame2 = frame1;
-            continue;
+            // skip frame if no features are found in both images
+            if (10 > tracks.size()) {
+                cout <<  "Could not find more than features in stereo 1: "  << std::endl ;
+                ++frame1;
+                frame2 = frame1;
+                continue;
+            }
         }
 
         skipFrameNumber = 0;
@@ -159,8 +357,15 @@ int main(){
             cout << "\n\n########################## FRAME "<<  frame1 << "  zu   " << frame2 << " ###################################" << endl;
 
             // load stereo2
-            cv::Mat image_L2 = cv::imread(dataPath + "left/" + filenames_left[frame2],0);
-            cv::Mat image_R2 = cv::imread(dataPath + "right/"+ filenames_right[frame2],0);
+            cv::Mat image_L2, image_R2;
+            bool loadedStereo2;
+            {
+                StageTimer timer("loadFrame");
+                loadedStereo2 = getFrame(frame2, image_L2, image_R2);
+            }
+            if (!loadedStereo2) {
+                break;
+            }
 
             // Check for invalid input
             if(! image_L2.data || !image_R2.data) {
@@ -170,12 +375,29 @@ int main(){
             }
 
             // find stereo 1 points in stereo 2 ...
-            std::vector<cv::Point2f> points_L1, points_R1, points_L2, points_R2;
-            refindFeaturePoints(image_L1, image_L2, points_L1_temp, points_L1, points_L2);
-            refindFeaturePoints(image_R1, image_R2, points_R1_temp, points_R1, points_R2);
+            CorrespondenceTable correspondences;
+            if (orbMatcher) {
+                StageTimer timer("fastFeatureMatcher");
+                fastFeatureMatcher(image_L1, image_R1, image_L2, image_R2, correspondences, F_LR, epipolarThreshold);
+            } else {
+                FrameProducts& stereo1 = cache.get(frame1);
+                FrameProducts& stereo2 = cache.get(frame2);
+                {
+                    StageTimer timer("refindFeaturePoints");
+                    refindFeaturePoints(pool, stereo1.pyramid_L, stereo1.pyramid_R, image_L2, image_R2, stereo2.pyramid_L, stereo2.pyramid_R,
+                                        tracks.points_L(), tracks.points_R(), correspondences);
+                }
+                // stereo 2 points become the stereo 1 points of the next frame
+                tracks.advance(frame2, correspondences.L2, correspondences.R2, correspondences.valid, image_L1.cols, image_L1.rows);
+            }
             // delete in all frames points, that are not visible in each frames
-            deleteUnvisiblePoints(points_L1_temp, points_R1_temp, points_L1, points_R1, points_L2, points_R2, image_L1.cols, image_L1.rows);
-            //fastFeatureMatcher(image_L1, image_L2, image_L2, image_R2, points_L1, points_R1, points_L2, points_R2);
+            correspondences.rejectUnvisible(image_L1.cols, image_L1.rows);
+            correspondences.compact();
+
+            std::vector<cv::Point2f>& points_L1 = correspondences.L1;
+            std::vector<cv::Point2f>& points_R1 = correspondences.R1;
+            std::vector<cv::Point2f>& points_L2 = correspondences.L2;
+            std::vector<cv::Point2f>& points_R2 = correspondences.R2;
 
             // skip frame if no features are found in both images
             if (0 == points_L1.size()) {
@@ -203,215 +425,251 @@ int main(){
                 //drawCorresPointsRef(color_image, points_L1, points_L2, "all points left", cv::Scalar(255,0,0));
 
                 // get inlier from stereo constraints
-                std::vector<cv::Point2f> inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2;
-                getInliersFromHorizontalDirection(make_pair(points_L1, points_R1), inliersHorizontal_L1, inliersHorizontal_R1);
-                getInliersFromHorizontalDirection(make_pair(points_L2, points_R2), inliersHorizontal_L2, inliersHorizontal_R2);
+                if (0 < epipolarThreshold) {
+                    getInliersFromEpipolarGeometry(points_L1, points_R1, F_LR, epipolarThreshold, correspondences.valid);
+                    getInliersFromEpipolarGeometry(points_L2, points_R2, F_LR, epipolarThreshold, correspondences.valid);
+                }
+                getInliersFromHorizontalDirection(points_L1, points_R1, correspondences.valid);
+                getInliersFromHorizontalDirection(points_L2, points_R2, correspondences.valid);
                 //delete all points that are not correctly found in stereo setup
-                deleteZeroLines(points_L1, points_R1, points_L2, points_R2, inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2);
+                correspondences.compact();
 
                 // skip frame because something fails with rectification (ex. frame 287 dbl)
-                if (8 > inliersHorizontal_L1.size()) {
+                if (8 > points_L1.size()) {
                     cout << "NO MOVEMENT: couldn't find horizontal points... probably rectification fails or to less feature points found?!" << endl;
                     skipFrame = true;
                     continue;
                 }
 
 
-                // compute fundemental matrix F_L1L2
-                cv::Mat F_L;
-                bool foundF_L;
-                std::vector<cv::Point2f> inliersF_L1, inliersF_L2;
-                foundF_L = getFundamentalMatrix(points_L1, points_L2, &inliersF_L1, &inliersF_L2, F_L);
-
-                // compute fundemental matrix F_R1R2
-                cv::Mat F_R;
-                bool foundF_R;
-                std::vector<cv::Point2f> inliersF_R1, inliersF_R2;
-                foundF_R = getFundamentalMatrix(points_R1, points_R2, &inliersF_R1, &inliersF_R2, F_R);
+                cv::Mat T_E_L, R_E_L, T_E_R, R_E_R;
+                if (jointRig) {
+                    // one RANSAC over both cameras, metric scale from the stereo clouds
+                    cv::Mat PK_0 = K_L * P_0;
+                    cv::Mat PK_LR = K_R * P_LR;
+                    std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
+                    cache.triangulate(frame1, PK_0, PK_LR, points_L1, points_R1, pointCloud_1);
+                    cache.triangulate(frame2, PK_0, PK_LR, points_L2, points_R2, pointCloud_2);
+
+                    bool foundRigMotion;
+                    {
+                        StageTimer timer("motionEstimationStereoRig");
+                        foundRigMotion = motionEstimationStereoRig(pointCloud_1, pointCloud_2, points_L2, points_R2, K_L, K_R, R_LR, T_LR,
+                                                                   T_E_L, R_E_L, &correspondences.quality);
+                    }
+                    if (!foundRigMotion) {
+                        cout << "NO MOVEMENT: couldn't find the rig motion" << endl;
+                        skipFrame = true;
+                        continue;
+                    }
 
-                // make sure that there are all inliers in all frames.
-                deleteZeroLines(inliersF_L1, inliersF_L2, inliersF_R1, inliersF_R2);
+                    // the right camera moves by [R_LR|T_LR] [R|T] [R_LR|T_LR]^-1
+                    RigidTransform rig(T_LR, R_LR);
+                    RigidTransform motion_R = rig * RigidTransform(T_E_L, R_E_L) * rig.inverse();
+                    T_E_R = motion_R.T_Mat();
+                    R_E_R = motion_R.R_Mat();
+                } else {
+                    // compute fundemental matrix F_L1L2 (with fivePoint F_L and F_R hold the essential matrices)
+                    cv::Mat F_L;
+                    bool foundF_L;
+                    {
+                        StageTimer timer(fivePoint ? "getEssentialMatrix" : "getFundamentalMatrix");
+                        foundF_L = fivePoint ? getEssentialMatrix(points_L1, points_L2, KInv_L, correspondences.valid, F_L, &correspondences.quality)
+                                             : getFundamentalMatrix(points_L1, points_L2, correspondences.valid, F_L, &correspondences.quality);
+                    }
 
+                    // compute fundemental matrix F_R1R2
+                    cv::Mat F_R;
+                    bool foundF_R;
+                    {
+                        StageTimer timer(fivePoint ? "getEssentialMatrix" : "getFundamentalMatrix");
+                        foundF_R = fivePoint ? getEssentialMatrix(points_R1, points_R2, KInv_R, correspondences.valid, F_R, &correspondences.quality)
+                                             : getFundamentalMatrix(points_R1, points_R2, correspondences.valid, F_R, &correspondences.quality);
+                    }
 
-                // skip frame because something fails with rectification (ex. frame 287 dbl)
-                // TODO: check how often this happens
-                if (1 > inliersF_L1.size()) {
-                    cout << "NO MOVEMENT: couldn't find enough ransac inlier" << endl;
-                    skipFrame = true;
-                    continue;
-                }
+                    // make sure that there are all inliers in all frames.
+                    CorrespondenceTable inliersF;
+                    correspondences.copyValid(inliersF);
+                    std::vector<cv::Point2f>& inliersF_L1 = inliersF.L1;
+                    std::vector<cv::Point2f>& inliersF_R1 = inliersF.R1;
+                    std::vector<cv::Point2f>& inliersF_L2 = inliersF.L2;
+                    std::vector<cv::Point2f>& inliersF_R2 = inliersF.R2;
+
+
+                    // skip frame because something fails with rectification (ex. frame 287 dbl)
+                    // TODO: check how often this happens
+                    if (1 > inliersF_L1.size()) {
+                        cout << "NO MOVEMENT: couldn't find enough ransac inlier" << endl;
+                        skipFrame = true;
+                        continue;
+                    }
 
-                drawCorresPoints(image_L1, inliersF_L1, inliersF_L2, "inlier F left " , CV_RGB(0,0,255));
-                drawCorresPoints(image_R1, inliersF_R1, inliersF_R2, "inlier F right " , CV_RGB(0,0,255));
+                    if (!headless) {
+                        drawCorresPoints(image_L1, inliersF_L1, inliersF_L2, "inlier F left " , CV_RGB(0,0,255));
+                        drawCorresPoints(image_R1, inliersF_R1, inliersF_R2, "inlier F right " , CV_RGB(0,0,255));
+                    }
 
-                //                // draw inliers
-                //                drawCorresPointsRef(color_image,inliersHorizontal_L1,  inliersHorizontal_L2, "inlier horizontal left", cv::Scalar(0,0,255));
-                //                drawCorresPointsRef(color_image, inliersF_L1, inliersF_L2, "inlier points left", cv::Scalar(0,255,0));
+                    //                // draw inliers
+                    //                drawCorresPointsRef(color_image,points_L1,  points_L2, "inlier horizontal left", cv::Scalar(0,0,255));
+                    //                drawCorresPointsRef(color_image, inliersF_L1, inliersF_L2, "inlier points left", cv::Scalar(0,255,0));
 
-                //                char key2 = cv::waitKey();
-                //                if (char(key2) == 's'){
-                //                    cv::imwrite("data/docu/inlier_outlier.jpg", color_image);
-                //                }
+                    //                char key2 = cv::waitKey();
+                    //                if (char(key2) == 's'){
+                    //                    cv::imwrite("data/docu/inlier_outlier.jpg", color_image);
+                    //                }
 
-                cv::Mat T_E_L, R_E_L, T_E_R, R_E_R;
-                // UP TO SCALE!!!
-                bool poseEstimationFoundES_L = false;
-                bool poseEstimationFoundES_R = false;
+                    // UP TO SCALE!!!
+                    bool poseEstimationFoundES_L = false;
+                    bool poseEstimationFoundES_R = false;
 
 
-                if(foundF_L){
-                    poseEstimationFoundES_L = motionEstimationEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_E_L, R_E_L);
-                }
+                    if(foundF_L){
+                        StageTimer timer("motionEstimationEssentialMat");
+                        poseEstimationFoundES_L = fivePoint ? motionEstimationFromEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_E_L, R_E_L)
+                                                          : motionEstimationEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_E_L, R_E_L);
+                    }
 
-                if(foundF_R){
-                    poseEstimationFoundES_R = motionEstimationEssentialMat(inliersF_R1, inliersF_R2, F_R, K_R, T_E_R, R_E_R);
-                }
+                    if(foundF_R){
+                        StageTimer timer("motionEstimationEssentialMat");
+                        poseEstimationFoundES_R = fivePoint ? motionEstimationFromEssentialMat(inliersF_R1, inliersF_R2, F_R, K_R, T_E_R, R_E_R)
+                                                          : motionEstimationEssentialMat(inliersF_R1, inliersF_R2, F_R, K_R, T_E_R, R_E_R);
+                    }
 
-                if (!poseEstimationFoundES_L && !poseEstimationFoundES_R){
-                    skipFrame = true;
-                    continue;
-                    T_E_L = cv::Mat::zeros(3, 1, CV_32F);
-                    R_E_L = cv::Mat::eye(3, 3, CV_32F);
-                    T_E_R = cv::Mat::zeros(3, 1, CV_32F);
-                    R_E_R = cv::Mat::eye(3, 3, CV_32F);
-                } else if (!poseEstimationFoundES_L){
-                    T_E_L = cv::Mat::zeros(3, 1, CV_32F);
-                    R_E_L = cv::Mat::eye(3, 3, CV_32F);
-                } else if (!poseEstimationFoundES_R){
-                    T_E_R = cv::Mat::zeros(3, 1, CV_32F);
-                    R_E_R = cv::Mat::eye(3, 3, CV_32F);
-                }
+                    if (!poseEstimationFoundES_L && !poseEstimationFoundES_R){
+                        skipFrame = true;
+                        continue;
+                        T_E_L = cv::Mat::zeros(3, 1, CV_32F);
+                        R_E_L = cv::Mat::eye(3, 3, CV_32F);
+                        T_E_R = cv::Mat::zeros(3, 1, CV_32F);
+                        R_E_R = cv::Mat::eye(3, 3, CV_32F);
+                    } else if (!poseEstimationFoundES_L){
+                        T_E_L = cv::Mat::zeros(3, 1, CV_32F);
+                        R_E_L = cv::Mat::eye(3, 3, CV_32F);
+                    } else if (!poseEstimationFoundES_R){
+                        T_E_R = cv::Mat::zeros(3, 1, CV_32F);
+                        R_E_R = cv::Mat::eye(3, 3, CV_32F);
+                    }
 
-                // find scale factors
-                // find right scale factors u und v (according to rodehorst paper)
+                    // find scale factors
+                    // find right scale factors u und v (according to rodehorst paper)
 
-                // calibrate projection mat
-                cv::Mat PK_0 = K_L * P_0;
-                cv::Mat PK_LR = K_R * P_LR;
+                    // calibrate projection mat
+                    cv::Mat PK_0 = K_L * P_0;
+                    cv::Mat PK_LR = K_R * P_LR;
 
-                // TRIANGULATE POINTS
-                std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
-                TriangulatePointsHZ(PK_0, PK_LR, points_L1, points_R1, 0, pointCloud_1);
-                TriangulatePointsHZ(PK_0, PK_LR, points_L2, points_R2, 0, pointCloud_2);
+                    // TRIANGULATE POINTS
+                    std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
+                    cache.triangulate(frame1, PK_0, PK_LR, points_L1, points_R1, pointCloud_1);
+                    cache.triangulate(frame2, PK_0, PK_LR, points_L2, points_R2, pointCloud_2);
 
-                // find scale factors
-                // find right scale factors u und v (according to rodehorst paper)
+                    // find scale factors
+                    // find right scale factors u und v (according to rodehorst paper)
 #if 1
-                // 1. method:
-                float u_L1, u_R1;
-                cv::Mat P_L, P_R;
-                composeProjectionMat(T_E_L, R_E_L, P_L);
-                composeProjectionMat(T_E_R, R_E_R, P_R);
-
-                // calibrate projection mat
-                cv::Mat PK_L = K_L * P_L;
-                cv::Mat PK_R = K_R * P_R;
-
-                std::vector<cv::Point3f> stereoCloud, nearestPoints;
-                getScaleFactor(PK_0, PK_LR, PK_L, PK_R, points_L1, points_R1, points_L2, points_R2, u_L1, u_R1, stereoCloud, nearestPoints);
-                std::cout << "skipFrameNumber : " << skipFrameNumber << std::endl;
-                if(u_L1 < -1 || u_L1 > 1000*skipFrameNumber){
-                    std::cout << "scale factors for left cam is too big: " << u_L1 << std::endl;
-                    //skipFrame = true;
-                    //continue;
-                } else {
-                    T_E_L = T_E_L * u_L1;
-                }
+                    // 1. method:
+                    float u_L1, u_R1;
+                    cv::Mat P_L, P_R;
+                    composeProjectionMat(T_E_L, R_E_L, P_L);
+                    composeProjectionMat(T_E_R, R_E_R, P_R);
+
+                    // calibrate projection mat
+                    cv::Mat PK_L = K_L * P_L;
+                    cv::Mat PK_R = K_R * P_R;
+
+                    std::vector<cv::Point3f> nearestPoints;
+                    {
+                        StageTimer timer("getScaleFactor");
+                        getScaleFactor(PK_0, PK_L, PK_R, pointCloud_1, points_L1, points_R1, points_L2, points_R2, u_L1, u_R1, nearestPoints);
+                    }
+                    std::cout << "skipFrameNumber : " << skipFrameNumber << std::endl;
+                    if(u_L1 < -1 || u_L1 > 1000*skipFrameNumber){
+                        std::cout << "scale factors for left cam is too big: " << u_L1 << std::endl;
+                        //skipFrame = true;
+                        //continue;
+                    } else {
+                        T_E_L = T_E_L * u_L1;
+                    }
 
-                if(u_R1 < -1 || u_R1 > 1000*skipFrameNumber ){
-                    std::cout << "scale factors for right cam is too big: " << u_R1 << std::endl;
-                    //skipFrame = true;
-                    //continue;
-                } else {
-                    T_E_R = T_E_R * u_R1;
-                }
+                    if(u_R1 < -1 || u_R1 > 1000*skipFrameNumber ){
+                        std::cout << "scale factors for right cam is too big: " << u_R1 << std::endl;
+                        //skipFrame = true;
+                        //continue;
+                    } else {
+                        T_E_R = T_E_R * u_R1;
+                    }
 
 #if 0
-                // get RGB values for pointcloud representation
-                std::vector<cv::Vec3b> RGBValues;
-                for (unsigned int i = 0; i < points_L1.size(); ++i){
-                    uchar grey = image_L1.at<uchar>(points_L1[i].x, points_L1[i].y);
-                    RGBValues.push_back(cv::Vec3b(grey,grey,grey));
-                }
+                    // get RGB values for pointcloud representation
+                    std::vector<cv::Vec3b> RGBValues;
+                    for (unsigned int i = 0; i < points_L1.size(); ++i){
+                        uchar grey = image_L1.at<uchar>(points_L1[i].x, points_L1[i].y);
+                        RGBValues.push_back(cv::Vec3b(grey,grey,grey));
+                    }
 
-                std::vector<cv::Vec3b> red;
-                for (unsigned int i = 0; i < 5; ++i){
-                    red.push_back(cv::Vec3b(0,0,255));
-                }
+                    std::vector<cv::Vec3b> red;
+                    for (unsigned int i = 0; i < 5; ++i){
+                        red.push_back(cv::Vec3b(0,0,255));
+                    }
 
-                AddPointcloudToVisualizer(stereoCloud, "cloud1" + std::to_string(frame1), RGBValues);
-                AddPointcloudToVisualizer(nearestPoints, "cloud2" + std::to_string(frame1), red);
+                    AddPointcloudToVisualizer(pointCloud_1, "cloud1" + std::to_string(frame1), RGBValues);
+                    AddPointcloudToVisualizer(nearestPoints, "cloud2" + std::to_string(frame1), red);
 #endif
-//                cout << "u links  1: " << u_L1 << endl;
-//                cout << "u rechts 1: " << u_R1 << endl << endl;
+    //                cout << "u links  1: " << u_L1 << endl;
+    //                cout << "u rechts 1: " << u_R1 << endl << endl;
 #else
-                // 2. method:
-                float u_L2, u_R2;
-                getScaleFactor2(T_LR, R_LR, T_E_L, R_E_L, T_E_R, u_L2, u_R2);
-
-                if(u_L2 < -1000 || u_R2 < -1000 || u_L2 > 1000 || u_R2 > 1000 ){
-                    std::cout << "scale factors to small or to big:  L: " << u_L2 << "  R: " << u_R2  << std::endl;
-                } else {
-                    T_E_L = T_E_L * u_L2;
-                    T_E_R = T_E_R * u_R2;
-                }
+                    // 2. method:
+                    float u_L2, u_R2;
+                    getScaleFactor2(T_LR, R_LR, T_E_L, R_E_L, T_E_R, u_L2, u_R2);
+
+                    if(u_L2 < -1000 || u_R2 < -1000 || u_L2 > 1000 || u_R2 > 1000 ){
+                        std::cout << "scale factors to small or to big:  L: " << u_L2 << "  R: " << u_R2  << std::endl;
+                    } else {
+                        T_E_L = T_E_L * u_L2;
+                        T_E_R = T_E_R * u_R2;
+                    }
 
-                //compare both methods
-                cout << "u links  2: " << u_L2 << endl;
-                cout << "u rechts 2: " << u_R2 << endl;
+                    //compare both methods
+                    cout << "u links  2: " << u_L2 << endl;
+                    cout << "u rechts 2: " << u_R2 << endl;
 #endif
+                }
 
 
                 //LEFT:
                 //rotateRandT(T_E_L, R_E_L);
 
                 std::cout << "translation 1: " << T_E_L << std::endl;
-                cv::Mat newTrans3D_E_L;
-                getNewTrans3D( T_E_L, R_E_L, newTrans3D_E_L);
-
-
-                cv::Mat newPos_ES_L;
-                getAbsPos(currentPos_ES_L, newTrans3D_E_L, R_E_L.t(), newPos_ES_L);
+                // the camera moved by the inverse of [R|T]
+                RigidTransform newPos_ES_L = currentPos_ES_L * RigidTransform(T_E_L, R_E_L).inverse();
 
 
                 std::stringstream left_ES;
                 left_ES << "camera_ES_left" << frame1;
 
-                cv::Mat rotation_ES_L, translation_ES_L;
-                decomposeProjectionMat(newPos_ES_L, translation_ES_L, rotation_ES_L);
-                //std::cout << "T_ES_left: " << translation_ES_L << std::endl;
+                //std::cout << "T_ES_left: " << newPos_ES_L.T_Mat() << std::endl;
 
-                //addCameraToVisualizer(translation_ES_L, rotation_ES_L, 255, 0, 0, 20, left_ES.str());
+                //addCameraToVisualizer(newPos_ES_L.t, newPos_ES_L.R, 255, 0, 0, 20, left_ES.str());
 
 
                 //RIGHT:
                 //rotateRandT(T_E_R, R_E_R);
 
-                cv::Mat newTrans3D_E_R;
-                getNewTrans3D( T_E_R, R_E_R, newTrans3D_E_R);
-
-                cv::Mat newPos_ES_R;
-                getAbsPos (currentPos_ES_R, newTrans3D_E_R, R_E_R.t(), newPos_ES_R);
+                RigidTransform newPos_ES_R = currentPos_ES_R * RigidTransform(T_E_R, R_E_R).inverse();
                 std::stringstream right_ES;
                 right_ES << "camera_ES_right" << frame1;
 
-                cv::Mat rotation_ES_R, translation_ES_R;
-                decomposeProjectionMat(newPos_ES_R, translation_ES_R, rotation_ES_R);
-                //std::cout << "T_ES_right: " << translation_ES_R << std::endl;
-                //addCameraToVisualizer(translation_ES_R, rotation_ES_R, 0, 255, 0, 20, right_ES.str());
+                //std::cout << "T_ES_right: " << newPos_ES_R.T_Mat() << std::endl;
+                //addCameraToVisualizer(newPos_ES_R.t, newPos_ES_R.R, 0, 255, 0, 20, right_ES.str());
 
 
                 // compute mean:
-                cv::Mat newPos_ES_mean = newPos_ES_L + newPos_ES_R;
-                newPos_ES_mean /= 2;
+                RigidTransform newPos_ES_mean = meanTransform(newPos_ES_L, newPos_ES_R);
 
                 std::stringstream mean_ES;
                 mean_ES << "camera_ES_mean" << frame1;
 
-                cv::Mat rotation_ES_mean, translation_ES_mean;
-                decomposeProjectionMat(newPos_ES_mean, translation_ES_mean, rotation_ES_mean);
-                //std::cout << "T_ES_right: " << translation_ES_R << std::endl;
-                addCameraToVisualizer(translation_ES_mean, rotation_ES_mean, 255, 0, 0, 20, mean_ES.str());
+                if (!headless) {
+                    addCameraToVisualizer(newPos_ES_mean.t, newPos_ES_mean.R, 255, 0, 0, 20, mean_ES.str());
+                }
 
 
                 currentPos_ES_mean = newPos_ES_mean;
@@ -419,7 +677,10 @@ int main(){
                 currentPos_ES_R = newPos_ES_R;
 
 
-                std::cout << "abs. position  "  << translation_ES_mean << std::endl;
+                std::cout << "abs. position  "  << newPos_ES_mean.T_Mat() << std::endl;
+                if (trajectory.is_open()) {
+                    writeTrajectoryPose(trajectory, frame1, frame2, newPos_ES_mean);
+                }
                 // ##############################################################################
             }
 
@@ -434,11 +695,14 @@ int main(){
                 }
 
                 // get inlier from stereo constraints
-                std::vector<cv::Point2f> inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2;
-                getInliersFromHorizontalDirection(make_pair(points_L1, points_R1), inliersHorizontal_L1, inliersHorizontal_R1);
-                getInliersFromHorizontalDirection(make_pair(points_L2, points_R2), inliersHorizontal_L2, inliersHorizontal_R2);
+                if (0 < epipolarThreshold) {
+                    getInliersFromEpipolarGeometry(points_L1, points_R1, F_LR, epipolarThreshold, correspondences.valid);
+                    getInliersFromEpipolarGeometry(points_L2, points_R2, F_LR, epipolarThreshold, correspondences.valid);
+                }
+                getInliersFromHorizontalDirection(points_L1, points_R1, correspondences.valid);
+                getInliersFromHorizontalDirection(points_L2, points_R2, correspondences.valid);
                 //delete all points that are not correctly found in stereo setup
-                deleteZeroLines(points_L1, points_R1, points_L2, points_R2, inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2);
+                correspondences.compact();
 
                 // skip frame because something fails with rectification (ex. frame 287 dbl)
                 if (8 > points_L1.size()) {
@@ -447,23 +711,36 @@ int main(){
                     continue;
                 }
 
-                // compute fundemental matrix F_L1L2 and get inliers from Ransac
+                // compute fundemental matrix F_L1L2 and get inliers from Ransac (the essential matrix with fivePoint)
                 cv::Mat F_L;
                 bool foundF_L;
-                std::vector<cv::Point2f> inliersF_L1, inliersF_L2;
-                foundF_L = getFundamentalMatrix(points_L1, points_L2, &inliersF_L1, &inliersF_L2, F_L);
+                {
+                    StageTimer timer(fivePoint ? "getEssentialMatrix" : "getFundamentalMatrix");
+                    foundF_L = fivePoint ? getEssentialMatrix(points_L1, points_L2, KInv_L, correspondences.valid, F_L, &correspondences.quality)
+                                         : getFundamentalMatrix(points_L1, points_L2, correspondences.valid, F_L, &correspondences.quality);
+                }
 
                 // compute fundemental matrix F_R1R2 and get inliers from Ransac
                 cv::Mat F_R;
                 bool foundF_R;
-                std::vector<cv::Point2f> inliersF_R1, inliersF_R2;
-                foundF_R = getFundamentalMatrix(points_R1, points_R2, &inliersF_R1, &inliersF_R2, F_R);
+                {
+                    StageTimer timer(fivePoint ? "getEssentialMatrix" : "getFundamentalMatrix");
+                    foundF_R = fivePoint ? getEssentialMatrix(points_R1, points_R2, KInv_R, correspondences.valid, F_R, &correspondences.quality)
+                                         : getFundamentalMatrix(points_R1, points_R2, correspondences.valid, F_R, &correspondences.quality);
+                }
 
                 // make sure that there are all inliers in all frames.
-                deleteZeroLines(inliersF_L1, inliersF_L2, inliersF_R1, inliersF_R2);
-
-                drawCorresPoints(image_R1, inliersF_R1, inliersF_R2, "inlier F right " , CV_RGB(0,0,255));
-                drawCorresPoints(image_L1, inliersF_L1, inliersF_L2, "inlier F left " , CV_RGB(0,0,255));
+                CorrespondenceTable inliersF;
+                correspondences.copyValid(inliersF);
+                std::vector<cv::Point2f>& inliersF_L1 = inliersF.L1;
+                std::vector<cv::Point2f>& inliersF_R1 = inliersF.R1;
+                std::vector<cv::Point2f>& inliersF_L2 = inliersF.L2;
+                std::vector<cv::Point2f>& inliersF_R2 = inliersF.R2;
+
+                if (!headless) {
+                    drawCorresPoints(image_R1, inliersF_R1, inliersF_R2, "inlier F right " , CV_RGB(0,0,255));
+                    drawCorresPoints(image_L1, inliersF_L1, inliersF_L2, "inlier F left " , CV_RGB(0,0,255));
+                }
 
                 // calibrate projection mat
                 cv::Mat PK_0 = K_L * P_0;
@@ -472,8 +749,8 @@ int main(){
 
                 // TRIANGULATE POINTS
                 std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
-                TriangulatePointsHZ(PK_0, PK_LR, inliersF_L1, inliersF_R1, 0, pointCloud_1);
-                TriangulatePointsHZ(PK_0, PK_LR, inliersF_L2, inliersF_R2, 0, pointCloud_2);
+                cache.triangulate(frame1, PK_0, PK_LR, inliersF_L1, inliersF_R1, pointCloud_1);
+                cache.triangulate(frame2, PK_0, PK_LR, inliersF_L2, inliersF_R2, pointCloud_2);
 
 
 #if 1
@@ -482,7 +759,9 @@ int main(){
                 cv::Mat T_PnP_L, R_PnP_L;
                 if(foundF_L){
                     // GUESS TRANSLATION + ROTATION UP TO SCALE!!!
-                    poseEstimationFoundTemp_L = motionEstimationEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_PnP_L, R_PnP_L);
+                    StageTimer timer("motionEstimationEssentialMat");
+                    poseEstimationFoundTemp_L = fivePoint ? motionEstimationFromEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_PnP_L, R_PnP_L)
+                                                        : motionEstimationEssentialMat(inliersF_L1, inliersF_L2, F_L, K_L, T_PnP_L, R_PnP_L);
                 }
 
                 if (!poseEstimationFoundTemp_L){
@@ -509,7 +788,11 @@ int main(){
                 T_PnP_L = T_PnP_L * u_L1;
 #endif
                 // use initial guess values for pose estimation
-                bool poseEstimationFoundPnP_L = motionEstimationPnP(inliersF_L2, pointCloud_1, K_L, T_PnP_L, R_PnP_L);
+                bool poseEstimationFoundPnP_L;
+                {
+                    StageTimer timer("motionEstimationPnP");
+                    poseEstimationFoundPnP_L = motionEstimationPnP(inliersF_L2, pointCloud_1, K_L, T_PnP_L, R_PnP_L);
+                }
 
                 if (!poseEstimationFoundPnP_L){
                     skipFrame = true;
@@ -523,19 +806,19 @@ int main(){
                     continue;
                 }
 
-                cv::Mat newTrans3D_PnP_L;
-                getNewTrans3D( T_PnP_L, R_PnP_L, newTrans3D_PnP_L);
-
-                cv::Mat newPos_PnP_L;
-                getAbsPos(currentPos_PnP_L, newTrans3D_PnP_L, R_PnP_L, newPos_PnP_L);
-
-                cv::Mat rotation_PnP_L, translation_PnP_L;
-                decomposeProjectionMat(newPos_PnP_L, translation_PnP_L, rotation_PnP_L);
+                // [R | -R^T*T], the same update as getAbsPos(currentPos, getNewTrans3D(T, R), R)
+                RigidTransform motion_PnP_L(T_PnP_L, R_PnP_L);
+                RigidTransform newPos_PnP_L = currentPos_PnP_L * RigidTransform(motion_PnP_L.R, motion_PnP_L.inverse().t);
 
                 std::stringstream left_PnP;
                 left_PnP << "camera_PnP_left" << frame1;
-                addCameraToVisualizer(translation_PnP_L, rotation_PnP_L, 255, 0, 0, 50, left_PnP.str());
-                std::cout << "abs. position:  " << translation_PnP_L << std::endl;
+                if (!headless) {
+                    addCameraToVisualizer(newPos_PnP_L.t, newPos_PnP_L.R, 255, 0, 0, 50, left_PnP.str());
+                }
+                std::cout << "abs. position:  " << newPos_PnP_L.T_Mat() << std::endl;
+                if (trajectory.is_open()) {
+                    writeTrajectoryPose(trajectory, frame1, frame2, newPos_PnP_L);
+                }
 
 
                 currentPos_PnP_L  = newPos_PnP_L ;
@@ -548,6 +831,7 @@ int main(){
                 cv::Mat  T_PnP_R, R_PnP_R;
                 if(foundF_R){
                     // GUESS TRANSLATION + ROTATION UP TO SCALE!!!
+                    StageTimer timer("motionEstimationEssentialMat");
                     poseEstimationFoundTemp_R = motionEstimationEssentialMat(inliersF_R1, inliersF_R2, F_R, K_R, KInv_R, T_PnP_R, R_PnP_R);
                 }
 
@@ -557,25 +841,29 @@ int main(){
                 }
 
                 // use initial guess values for pose estimation
-                bool poseEstimationFoundPnP_R = motionEstimationPnP(inliersF_R2, pointCloud_1, K_R, T_PnP_R, R_PnP_R);
+                bool poseEstimationFoundPnP_R;
+                {
+                    StageTimer timer("motionEstimationPnP");
+                    poseEstimationFoundPnP_R = motionEstimationPnP(inliersF_R2, pointCloud_1, K_R, T_PnP_R, R_PnP_R);
+                }
 
                 if (!poseEstimationFoundPnP_R){
                     skipFrame = true;
                     continue;
                 }
 
-                cv::Mat newTrans3D_PnP_R;
-                getNewTrans3D( T_PnP_R, R_PnP_R, newTrans3D_PnP_R);
-
-                cv::Mat newPos_PnP_R;
-                getAbsPos(currentPos_PnP_R, newTrans3D_PnP_R, R_PnP_R, newPos_PnP_R);
-
-                cv::Mat rotation_PnP_R, translation_PnP_R;
-                decomposeProjectionMat(newPos_PnP_R, translation_PnP_R, rotation_PnP_R);
+                // [R | -R^T*T], the same update as getAbsPos(currentPos, getNewTrans3D(T, R), R)
+                RigidTransform motion_PnP_R(T_PnP_R, R_PnP_R);
+                RigidTransform newPos_PnP_R = currentPos_PnP_R * RigidTransform(motion_PnP_R.R, motion_PnP_R.inverse().t);
 
                 std::stringstream right_PnP;
                 right_PnP << "camera_PnP_right" << frame1;
-                addCameraToVisualizer(translation_PnP_R, rotation_PnP_R, 0, 255, 0, 20, right_PnP.str());
+                if (!headless) {
+                    addCameraToVisualizer(newPos_PnP_R.t, newPos_PnP_R.R, 0, 255, 0, 20, right_PnP.str());
+                }
+                if (trajectory.is_open()) {
+                    writeTrajectoryPose(trajectory, frame1, frame2, newPos_PnP_R);
+                }
                 currentPos_PnP_R  = newPos_PnP_R ;
 #endif
                 // ##############################################################################
@@ -587,11 +875,14 @@ int main(){
 
 
                 // get inlier from stereo constraints
-                std::vector<cv::Point2f> inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2;
-                getInliersFromHorizontalDirection(make_pair(points_L1, points_R1), inliersHorizontal_L1, inliersHorizontal_R1);
-                getInliersFromHorizontalDirection(make_pair(points_L2, points_R2), inliersHorizontal_L2, inliersHorizontal_R2);
+                if (0 < epipolarThreshold) {
+                    getInliersFromEpipolarGeometry(points_L1, points_R1, F_LR, epipolarThreshold, correspondences.valid);
+                    getInliersFromEpipolarGeometry(points_L2, points_R2, F_LR, epipolarThreshold, correspondences.valid);
+                }
+                getInliersFromHorizontalDirection(points_L1, points_R1, correspondences.valid);
+                getInliersFromHorizontalDirection(points_L2, points_R2, correspondences.valid);
                 //delete all points that are not correctly found in stereo setup
-                deleteZeroLines(points_L1, points_R1, points_L2, points_R2, inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2);
+                correspondences.compact();
 
                 // skip frame because something fails with rectification (ex. frame 287 dbl)
                 if (8 > points_L1.size()) {
@@ -601,8 +892,10 @@ int main(){
                 }
 
                 // for cv::waitKey input:
-                drawCorresPoints(image_L1, points_L1, points_R1, "inlier F1 links rechts", cv::Scalar(255,255,0));
-                drawCorresPoints(image_L2, points_L2, points_R2, "inlier F2 links rechts", cv::Scalar(255,255,0));
+                if (!headless) {
+                    drawCorresPoints(image_L1, points_L1, points_R1, "inlier F1 links rechts", cv::Scalar(255,255,0));
+                    drawCorresPoints(image_L2, points_L2, points_R2, "inlier F2 links rechts", cv::Scalar(255,255,0));
+                }
 
                 // calibrate projection mat
                 cv::Mat PK_0 = K_L * P_0;
@@ -610,8 +903,8 @@ int main(){
 
                 // TRIANGULATE POINTS
                 std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
-                TriangulatePointsHZ(PK_0, PK_LR, points_L1, points_R1, 0, pointCloud_1);
-                TriangulatePointsHZ(PK_0, PK_LR, points_L2, points_R2, 0, pointCloud_2);
+                cache.triangulate(frame1, PK_0, PK_LR, points_L1, points_R1, pointCloud_1);
+                cache.triangulate(frame2, PK_0, PK_LR, points_L2, points_R2, pointCloud_2);
 
 
                 float reproj_error_1L = calculateReprojectionErrorHZ(PK_0, points_L1, pointCloud_1);
@@ -635,39 +928,23 @@ int main(){
                 }
 
 #if 0
-                //load disparity map
-                cv::Mat dispMap1;
-                cv::FileStorage fs_dist1(dataPath + "disparity/disparity_"+to_string(frame)+".yml", cv::FileStorage::READ);
-                fs_dist1["disparity"] >> dispMap1;
-                fs_dist1.release();
-
-                cv::Mat dispMap2;
-                cv::FileStorage fs_dist2(dataPath + "disparity/disparity_"+to_string(frame+1)+".yml", cv::FileStorage::READ);
-                fs_dist2["disparity"] >> dispMap2;
-                fs_dist2.release();
-
-                dispMap1.convertTo(dispMap1, CV_32F);
-                dispMap2.convertTo(dispMap2, CV_32F);
-
-                std::vector <cv::Mat_<float>> cloud1;
-                std::vector <cv::Mat_<float>> cloud2;
-                for(unsigned int i = 0; i < inlier_median_L1.size(); ++i){
-                    cv::Mat_<float> point3D1(1,4);
-                    cv::Mat_<float> point3D2(1,4);
-                    calcCoordinate(point3D1, Q, dispMap1, inlier_median_L1[i].x, inlier_median_L1[i].y);
-                    calcCoordinate(point3D2, Q, dispMap2, inlier_median_L2[i].x, inlier_median_L2[i].y);
-                    cloud1.push_back(point3D1);
-                    cloud2.push_back(point3D2);
-                }
+                //load disparity map (memory mapped, convert the yml files with DisparityConverter)
+                MappedDisparityMap disparity1(dataPath + "disparity/disparity_"+to_string(frame1)+".disp");
+                MappedDisparityMap disparity2(dataPath + "disparity/disparity_"+to_string(frame2)+".disp");
+                const cv::Mat& dispMap1 = disparity1.disparity();
+                const cv::Mat& dispMap2 = disparity2.disparity();
 
                 std::vector<cv::Point3f> pcloud1, pcloud2;
                 std::vector<cv::Vec3b> rgb1, rgb2;
-                for (unsigned int i = 0; i < cloud1.size(); ++i) {
-                    if (!cloud1[i].empty() && !cloud2[i].empty()){
-                        pcloud1.push_back(cv::Point3f(cloud1[i](0), cloud1[i](1), cloud1[i](2) ));
-                                          pcloud2.push_back(cv::Point3f(cloud2[i](0), cloud2[i](1), cloud2[i](2) ));
-                                                            rgb1.push_back(cv::Vec3b(255,0,0));
-                                          rgb2.push_back(cv::Vec3b(0,255,0));
+                for(unsigned int i = 0; i < points_L1.size(); ++i){
+                    cv::Mat_<float> point3D1(1,4);
+                    cv::Mat_<float> point3D2(1,4);
+                    if (calcCoordinate(point3D1, Q, dispMap1, points_L1[i].x, points_L1[i].y) &&
+                            calcCoordinate(point3D2, Q, dispMap2, points_L2[i].x, points_L2[i].y)) {
+                        pcloud1.push_back(cv::Point3f(point3D1(0), point3D1(1), point3D1(2)));
+                        pcloud2.push_back(cv::Point3f(point3D2(0), point3D2(1), point3D2(2)));
+                        rgb1.push_back(cv::Vec3b(255,0,0));
+                        rgb2.push_back(cv::Vec3b(0,255,0));
                     }
                 }
 
@@ -679,7 +956,11 @@ int main(){
 
 #else
                 cv::Mat T_Stereo, R_Stereo;
-                bool poseEstimationFoundStereo = motionEstimationStereoCloudMatching(pointCloud_1, pointCloud_2, T_Stereo, R_Stereo);
+                bool poseEstimationFoundStereo;
+                {
+                    StageTimer timer("motionEstimationStereoCloudMatching");
+                    poseEstimationFoundStereo = motionEstimationStereoCloudMatching(pointCloud_1, pointCloud_2, T_Stereo, R_Stereo);
+                }
 #endif
 
                 if (!poseEstimationFoundStereo){
@@ -698,21 +979,21 @@ int main(){
                 cout << "y angle:"<< y_angle << endl;
                 cout << "z angle:"<< z_angle << endl;
 
-                cv::Mat newTrans3D_Stereo;
-                getNewTrans3D( T_Stereo, R_Stereo, newTrans3D_Stereo);
-
                 //STEREO:
-                cv::Mat newPos_Stereo;
-                getAbsPos (currentPos_Stereo, newTrans3D_Stereo, R_Stereo, newPos_Stereo);
+                RigidTransform motion_Stereo(T_Stereo, R_Stereo);
+                RigidTransform newPos_Stereo = currentPos_Stereo * RigidTransform(motion_Stereo.R, motion_Stereo.inverse().t);
                 std::stringstream stereo;
                 stereo << "camera_Stereo" << frame1;
 
-                cv::Mat rotation, translation;
-                decomposeProjectionMat(newPos_Stereo, translation, rotation);
-                //std::cout << "T: " << translation << std::endl;
+                //std::cout << "T: " << newPos_Stereo.T_Mat() << std::endl;
 
-                addCameraToVisualizer(translation, rotation, 0, 0, 255, 100, stereo.str());
+                if (!headless) {
+                    addCameraToVisualizer(newPos_Stereo.t, newPos_Stereo.R, 0, 0, 255, 100, stereo.str());
+                }
 
+                if (trajectory.is_open()) {
+                    writeTrajectoryPose(trajectory, frame1, frame2, newPos_Stereo);
+                }
                 currentPos_Stereo = newPos_Stereo;
                 // ##############################################################################
             }
@@ -721,14 +1002,19 @@ int main(){
             if (4 == mode){
                 // ######################## TRIANGULATION TEST ################################
                 // get inlier from stereo constraints
-                std::vector<cv::Point2f> inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2;
-                getInliersFromHorizontalDirection(make_pair(points_L1, points_R1), inliersHorizontal_L1, inliersHorizontal_R1);
-                getInliersFromHorizontalDirection(make_pair(points_L2, points_R2), inliersHorizontal_L2, inliersHorizontal_R2);
+                if (0 < epipolarThreshold) {
+                    getInliersFromEpipolarGeometry(points_L1, points_R1, F_LR, epipolarThreshold, correspondences.valid);
+                    getInliersFromEpipolarGeometry(points_L2, points_R2, F_LR, epipolarThreshold, correspondences.valid);
+                }
+                getInliersFromHorizontalDirection(points_L1, points_R1, correspondences.valid);
+                getInliersFromHorizontalDirection(points_L2, points_R2, correspondences.valid);
                 //delete all points that are not correctly found in stereo setup
-                deleteZeroLines(points_L1, points_R1, points_L2, points_R2, inliersHorizontal_L1, inliersHorizontal_R1, inliersHorizontal_L2, inliersHorizontal_R2);
+                correspondences.compact();
 
-                drawCorresPoints(image_L1, points_L1, points_R1, "inlier 1 " , CV_RGB(0,0,255));
-                drawCorresPoints(image_R1, points_L2, points_R2, "inlier 2 " , CV_RGB(0,0,255));
+                if (!headless) {
+                    drawCorresPoints(image_L1, points_L1, points_R1, "inlier 1 " , CV_RGB(0,0,255));
+                    drawCorresPoints(image_R1, points_L2, points_R2, "inlier 2 " , CV_RGB(0,0,255));
+                }
 
                 if(0 == points_L1.size()){
                     skipFrame = true;
@@ -741,8 +1027,8 @@ int main(){
 
                 // TRIANGULATE POINTS
                 std::vector<cv::Point3f> pointCloud_1, pointCloud_2;
-                TriangulatePointsHZ(PK_0, PK_LR, points_L1, points_R1, 0, pointCloud_1);
-                TriangulatePointsHZ(PK_0, PK_LR, points_L2, points_R2, 0, pointCloud_2);
+                cache.triangulate(frame1, PK_0, PK_LR, points_L1, points_R1, pointCloud_1);
+                cache.triangulate(frame2, PK_0, PK_LR, points_L2, points_R2, pointCloud_2);
 
 
                 if(0 == pointCloud_1.size()) {
@@ -752,14 +1038,15 @@ int main(){
                 }
 
 
-                // get RGB values for pointcloud representation
-                std::vector<cv::Vec3b> RGBValues;
-                for (unsigned int i = 0; i < points_L1.size(); ++i){
-                    uchar grey = image_L1.at<uchar>(points_L1[i].x, points_L1[i].y);
-                    RGBValues.push_back(cv::Vec3b(grey,grey,grey));
-                }
+                if (!headless) {
+                    // get RGB values for pointcloud representation
+                    std::vector<cv::Vec3b> RGBValues;
+                    for (unsigned int i = 0; i < points_L1.size(); ++i){
+                        uchar grey = image_L1.at<uchar>(points_L1[i].x, points_L1[i].y);
+                        RGBValues.push_back(cv::Vec3b(grey,grey,grey));
+                    }
 
-                AddPointcloudToVisualizer(pointCloud_1, "cloud1" + std::to_string(frame1), RGBValues);
+                    AddPointcloudToVisualizer(pointCloud_1, "cloud1" + std::to_string(frame1), RGBValues);
 
 #if 1
 //                int index = 0;
@@ -768,8 +1055,11 @@ int main(){
 //                    cout<< "HZ:  "<< index << ":  " << i << "   length: " << length << endl;
 //                    ++index;
 //                }
-                std::vector<cv::Point3f> pcloud_CV;
-                TriangulateOpenCV(PK_0, PK_LR, points_L1, points_R1, pcloud_CV);
+                    std::vector<cv::Point3f> pcloud_CV;
+                    {
+                        StageTimer timer("TriangulateOpenCV");
+                        TriangulateOpenCV(PK_0, PK_LR, points_L1, points_R1, pcloud_CV);
+                    }
 
 //                index = 0;
 //                for (auto i : pcloud_CV) {
@@ -777,23 +1067,28 @@ int main(){
 //                    cout<< "CV:  "<< index << ":  " << i << "   length: " << length << endl;
 //                    ++index;
 //                }
-                std::vector<cv::Vec3b> RGBValues2;
-                for (unsigned int i = 0; i < points_L1.size(); ++i){
-                    //uchar grey2 = image_L2.at<uchar>(points_L2[i].x, points_L2[i].y);
-                    //RGBValues2.push_back(cv::Vec3b(grey2,grey2,grey2));
-                    RGBValues2.push_back(cv::Vec3b(255,0,0));
-                }
+                    std::vector<cv::Vec3b> RGBValues2;
+                    for (unsigned int i = 0; i < points_L1.size(); ++i){
+                        //uchar grey2 = image_L2.at<uchar>(points_L2[i].x, points_L2[i].y);
+                        //RGBValues2.push_back(cv::Vec3b(grey2,grey2,grey2));
+                        RGBValues2.push_back(cv::Vec3b(255,0,0));
+                    }
 
-                AddPointcloudToVisualizer(pcloud_CV, "cloud2" + std::to_string(frame1), RGBValues2);
+                    AddPointcloudToVisualizer(pcloud_CV, "cloud2" + std::to_string(frame1), RGBValues2);
 #endif
+                }
                 // AddLineToVisualizer(pointCloud_inlier_1, pointCloud_inlier_2, "line"+std::to_string(frame1), cv::Scalar(255,0,0));
 
             }
 
+            // the frame pair is done (skipped attempts and a pair given up after 4 skips are no frame)
+            if (isTimingEnabled()) {
+                addStageTime("frame", chrono::duration<double>(chrono::steady_clock::now() - frameStart).count());
+            }
 
             // To Do:
             // swap image files...
-            if (-1 < frame1){
+            if (!headless && -1 < frame1){
                 key = cv::waitKey(10);
                 if (char(key) == 32) {
                     loop = !loop;
@@ -816,7 +1111,12 @@ int main(){
 
             }
 
-            if (frame1 == filenames_left.size()-2){
+            if (headless && frame1 == numberOfFrames-2){
+                std::cout << "finished." << std::endl;
+                return 0;
+            }
+
+            if (frame1 == numberOfFrames-2){
                 std::cout << "finished. press q to quit." << std::endl;
                 int i = 0;
                 while (true){
@@ -830,7 +1130,9 @@ int main(){
             }
         }
     }
-        cv::waitKey();
+        if (!headless) {
+            cv::waitKey();
+        }
         return 0;
 }
 